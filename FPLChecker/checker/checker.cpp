@@ -29,12 +29,38 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SparseBitVector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "shim.h"
 
 #define MAX_BB (1 << 10)        // function中最大basicblock数
 #define MAX_INST (1 << 20)      // function中最大instruction数
@@ -49,6 +75,1283 @@
 // Pass要声明在llvm命名空间内
 using namespace llvm;
 
+// -checker-entry: 函数名中含有该字符串的函数作为入口函数分析
+static cl::opt<std::string> CheckerEntry("checker-entry", cl::init("getPrivate"),
+        cl::desc("analyse functions whose name contains this string as entries"));
+
+// -checker-threads: 并行分析入口函数的线程数，1为串行，0表示按硬件线程数
+static cl::opt<unsigned> CheckerThreads("checker-threads", cl::init(1),
+        cl::desc("threads used to analyse entry functions (0 = hardware threads)"));
+
+// -checker-ifds: 用IFDS制表算法在入口函数及其调用图上做过程间污点分析
+static cl::opt<bool> CheckerIFDS("checker-ifds", cl::init(false),
+        cl::desc("run the IFDS taint solver from each entry function"));
+
+// -checker-tier: 污点分析的层级。fast只做基于合一的粗粒度检查；tiered先做粗粒度检查，
+// 源与汇点可能相连或自身调用了shim API的入口函数再交给IFDS；precise为原来的行为（由-checker-ifds决定是否运行IFDS）
+enum CheckerTier { TIER_PRECISE, TIER_FAST, TIER_TIERED };
+static cl::opt<CheckerTier> CheckerTierMode("checker-tier", cl::init(TIER_PRECISE),
+        cl::desc("taint analysis tier"),
+        cl::values(clEnumValN(TIER_PRECISE, "precise", "IFDS only, enabled by -checker-ifds"),
+                   clEnumValN(TIER_FAST, "fast", "unification-based alias and coarse taint reachability only"),
+                   clEnumValN(TIER_TIERED, "tiered", "coarse check first, escalate possible connections to IFDS")));
+
+// -checker-pts: 先对整个模块做基于包含的指针分析，IFDS在load/store/调用边上按指向集合匹配内存对象
+static cl::opt<bool> CheckerPts("checker-pts", cl::init(false),
+        cl::desc("resolve IFDS memory facts with a module-wide inclusion-based points-to analysis"));
+
+#define PTS_NONE (~0u)              // 不含指针的值没有结点
+
+// 类型T的值是否可能含有指针，结果记在memo中
+static bool Has_Ptr(Type *T, DenseMap<Type *, bool> &memo)
+{
+    if (T->isPointerTy())
+        return true;
+    if (!T->isAggregateType() && !T->isVectorTy())
+        return false;
+    auto it = memo.find(T);
+    if (it != memo.end())
+        return it->second;
+    bool has = false;
+    for (Type *E : T->subtypes())
+        if (Has_Ptr(E, memo)) {
+            has = true;
+            break;
+        }
+    memo[T] = has;
+    return has;
+}
+
+// Andersen风格的指向分析：字段不敏感、流不敏感、上下文不敏感
+// 抽象对象为分配点：alloca、全局变量、函数，以及无定义函数（runtime.newobject、runtime.makeslice、runtime.makemap等）的调用结果
+// 对象本身也是一个结点，其指向集合表示对象内容可能指向的对象；聚合类型的值（如切片{i8*, i64, i64}）整体作为一个结点
+// 求解用差分传播（结点只把上次处理之后新增的对象传给后继），沿复制边传播后两端集合相同时惰性地检测环，环上的结点合并为一个
+struct PointsTo
+{
+    struct Node
+    {
+        SparseBitVector<> Pts;          // 可能指向的对象（对象结点编号）
+        SparseBitVector<> Prev;         // 已经传播过的部分
+        SparseBitVector<> Copy;         // 复制边：后继 ⊇ 本结点
+        std::vector<unsigned> Loads;    // dst ⊇ *本结点
+        std::vector<unsigned> Stores;   // *本结点 ⊇ src
+        std::vector<CallBase *> Calls;  // 被调值为本结点的间接调用
+    };
+    std::vector<Node> Nodes;
+    std::vector<unsigned> Rep;                  // 并查集：合并后的结点 → 代表结点
+    std::vector<Value *> Sites;                 // 对象结点 → 分配点，其他结点为nullptr
+    std::vector<std::vector<unsigned>> Frozen;  // 求解后各代表结点的指向集合，查询只读这张表
+    DenseMap<Value *, unsigned> ValNode;        // 值 → 结点
+    DenseMap<Value *, unsigned> ObjNode;        // 分配点 → 对象结点
+    DenseMap<Function *, unsigned> RetNode;     // 函数 → 所有返回值的并
+    DenseMap<Type *, bool> PtrTypes;
+    DenseSet<std::pair<unsigned, unsigned>> Checked;          // 已触发过环检测的复制边
+    DenseSet<std::pair<CallBase *, Function *>> Resolved;     // 已连接的间接调用边
+    std::vector<unsigned> Worklist;
+    std::vector<bool> InList;
+    unsigned long Constraints, Collapsed, CycleRuns, IndirectEdges, Objects, PtsTotal, PtsValues;
+
+    PointsTo() : Constraints(0), Collapsed(0), CycleRuns(0), IndirectEdges(0), Objects(0), PtsTotal(0), PtsValues(0) {}
+
+    unsigned New_Node(Value *site)
+    {
+        Nodes.emplace_back();
+        Rep.push_back(Nodes.size() - 1);
+        Sites.push_back(site);
+        InList.push_back(false);
+        return Nodes.size() - 1;
+    }
+
+    unsigned Find(unsigned n)
+    {
+        while (Rep[n] != n) {
+            Rep[n] = Rep[Rep[n]];
+            n = Rep[n];
+        }
+        return n;
+    }
+
+    void Push(unsigned n)
+    {
+        if (!InList[n]) {
+            InList[n] = true;
+            Worklist.push_back(n);
+        }
+    }
+
+    unsigned Obj(Value *site)
+    {
+        auto it = ObjNode.find(site);
+        if (it != ObjNode.end())
+            return it->second;
+        unsigned o = New_Node(site);
+        ObjNode[site] = o;
+        Objects++;
+        return o;
+    }
+
+    void Addr(unsigned p, unsigned o)
+    {
+        Constraints++;
+        if (Nodes[p].Pts.test_and_set(o))
+            Push(p);
+    }
+
+    // 复制边src → dst；求解过程中新加的边立即把src的全部指向集合传给dst
+    void Add_Copy(unsigned src, unsigned dst)
+    {
+        src = Find(src);
+        dst = Find(dst);
+        if (src == dst || !Nodes[src].Copy.test_and_set(dst))
+            return;
+        Constraints++;
+        if (Nodes[dst].Pts |= Nodes[src].Pts)
+            Push(dst);
+    }
+
+    // 值v的结点：全局值取其对象的地址，常量表达式与常量聚合由各操作数复制而来，null、undef等常量没有结点
+    unsigned Node_Of(Value *v)
+    {
+        auto it = ValNode.find(v);
+        if (it != ValNode.end())
+            return it->second;
+        unsigned n;
+        if (GlobalValue *G = dyn_cast<GlobalValue>(v)) {
+            n = New_Node(nullptr);
+            ValNode[v] = n;
+            Addr(n, Obj(G));
+            return n;
+        }
+        if (Constant *C = dyn_cast<Constant>(v)) {
+            if (isa<ConstantData>(C) || isa<BlockAddress>(C))
+                return PTS_NONE;
+            n = New_Node(nullptr);
+            ValNode[v] = n;
+            for (Value *op : C->operands()) {
+                unsigned m = Node_Of(op);
+                if (m != PTS_NONE)
+                    Add_Copy(m, n);
+            }
+            return n;
+        }
+        if ((isa<Instruction>(v) || isa<Argument>(v)) && (Has_Ptr(v->getType(), PtrTypes) || isa<PtrToIntInst>(v))) {
+            n = New_Node(nullptr);
+            ValNode[v] = n;
+            return n;
+        }
+        return PTS_NONE;
+    }
+
+    unsigned Ret_Node(Function *F)
+    {
+        auto it = RetNode.find(F);
+        if (it != RetNode.end())
+            return it->second;
+        unsigned n = New_Node(nullptr);
+        RetNode[F] = n;
+        return n;
+    }
+
+    // 实参 → 形参，返回值 → 调用结果
+    void Bind_Call(CallBase *CB, Function *F)
+    {
+        for (unsigned j = 0; j < CB->arg_size() && j < F->arg_size(); j++) {
+            unsigned a = Node_Of(CB->getArgOperand(j));
+            if (a == PTS_NONE)
+                continue;
+            unsigned f = Node_Of(F->getArg(j));
+            if (f != PTS_NONE)
+                Add_Copy(a, f);
+        }
+        unsigned r = Node_Of(CB);
+        if (r != PTS_NONE)
+            Add_Copy(Ret_Node(F), r);
+    }
+
+    void Build_Call(CallBase *CB)
+    {
+        Function *callee = dyn_cast<Function>(CB->getCalledOperand()->stripPointerCasts());
+        if (!callee) {
+            unsigned f = Node_Of(CB->getCalledOperand());
+            if (f != PTS_NONE)
+                Nodes[f].Calls.push_back(CB);
+            return;
+        }
+        if (!callee->isDeclaration()) {
+            Bind_Call(CB, callee);
+            return;
+        }
+        // memcpy/memmove：*dst ⊇ *src，经一个临时结点
+        if (MemTransferInst *MT = dyn_cast<MemTransferInst>(CB)) {
+            unsigned src = Node_Of(MT->getRawSource()), dst = Node_Of(MT->getRawDest());
+            if (src == PTS_NONE || dst == PTS_NONE)
+                return;
+            unsigned t = New_Node(nullptr);
+            Nodes[src].Loads.push_back(t);
+            Nodes[dst].Stores.push_back(t);
+            Constraints += 2;
+            return;
+        }
+        if (isa<IntrinsicInst>(CB))
+            return;
+        // 无定义的函数返回的指针指向一个新对象，分配点为调用指令
+        unsigned r = Node_Of(CB);
+        if (r != PTS_NONE)
+            Addr(r, Obj(CB));
+    }
+
+    void Build_Inst(Instruction *I)
+    {
+        unsigned n;
+        if (isa<AllocaInst>(I)) {
+            Addr(Node_Of(I), Obj(I));
+        } else if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+            unsigned p = Node_Of(LI->getPointerOperand());
+            if ((n = Node_Of(I)) != PTS_NONE && p != PTS_NONE) {
+                Nodes[p].Loads.push_back(n);
+                Constraints++;
+            }
+        } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+            unsigned p = Node_Of(SI->getPointerOperand());
+            if ((n = Node_Of(SI->getValueOperand())) != PTS_NONE && p != PTS_NONE) {
+                Nodes[p].Stores.push_back(n);
+                Constraints++;
+            }
+        } else if (CallBase *CB = dyn_cast<CallBase>(I)) {
+            Build_Call(CB);
+        } else if (ReturnInst *RI = dyn_cast<ReturnInst>(I)) {
+            if (RI->getReturnValue() && (n = Node_Of(RI->getReturnValue())) != PTS_NONE)
+                Add_Copy(n, Ret_Node(I->getFunction()));
+        } else if ((n = Node_Of(I)) != PTS_NONE) {
+            // getelementptr、bitcast、phi、select、extractvalue/insertvalue等：结果 ⊇ 各操作数
+            for (Value *op : I->operands()) {
+                unsigned m = Node_Of(op);
+                if (m != PTS_NONE)
+                    Add_Copy(m, n);
+            }
+        }
+    }
+
+    // 从start出发在复制边上求强连通分量（迭代的Tarjan算法），每个分量合并为一个结点
+    void Detect(unsigned start)
+    {
+        CycleRuns++;
+        struct Frame
+        {
+            unsigned N;
+            std::vector<unsigned> Succ;
+            size_t K;
+        };
+        DenseMap<unsigned, unsigned> index, low;
+        DenseSet<unsigned> onstack;
+        std::vector<unsigned> stack;
+        std::vector<Frame> frames;
+        auto enter = [&](unsigned n) {
+            unsigned k = index.size();
+            index[n] = low[n] = k;
+            stack.push_back(n);
+            onstack.insert(n);
+            Frame f{n, {}, 0};
+            for (unsigned m : Nodes[n].Copy)
+                if ((m = Find(m)) != n)
+                    f.Succ.push_back(m);
+            frames.push_back(std::move(f));
+        };
+        enter(Find(start));
+        while (!frames.empty()) {
+            Frame &f = frames.back();
+            if (f.K < f.Succ.size()) {
+                unsigned m = Find(f.Succ[f.K++]);
+                auto it = index.find(m);
+                if (it == index.end())
+                    enter(m);
+                else if (onstack.count(m))
+                    low[f.N] = std::min(low[f.N], it->second);
+                continue;
+            }
+            unsigned n = f.N;
+            frames.pop_back();
+            if (!frames.empty())
+                low[frames.back().N] = std::min(low[frames.back().N], low[n]);
+            if (low[n] != index[n])
+                continue;
+            unsigned m;
+            do {
+                m = stack.back();
+                stack.pop_back();
+                onstack.erase(m);
+                if (m != n)
+                    Merge(n, m);
+            } while (m != n);
+        }
+    }
+
+    // 把b合并进a；a已处理过的部分取两者的交，b的约束在a上重新处理
+    void Merge(unsigned a, unsigned b)
+    {
+        Rep[b] = a;
+        Collapsed++;
+        Node &A = Nodes[a], &B = Nodes[b];
+        A.Pts |= B.Pts;
+        A.Prev &= B.Prev;
+        A.Copy |= B.Copy;
+        A.Copy.reset(a);
+        A.Copy.reset(b);
+        A.Loads.insert(A.Loads.end(), B.Loads.begin(), B.Loads.end());
+        A.Stores.insert(A.Stores.end(), B.Stores.begin(), B.Stores.end());
+        A.Calls.insert(A.Calls.end(), B.Calls.begin(), B.Calls.end());
+        B = Node();
+        Push(a);
+    }
+
+    void Solve()
+    {
+        for (unsigned n = 0; n < Nodes.size(); n++)
+            if (!Nodes[n].Pts.empty())
+                Push(n);
+        while (!Worklist.empty()) {
+            unsigned n = Worklist.back();
+            Worklist.pop_back();
+            InList[n] = false;
+            if (Find(n) != n)
+                continue;
+            SparseBitVector<> delta = Nodes[n].Pts;
+            delta.intersectWithComplement(Nodes[n].Prev);
+            if (delta.empty())
+                continue;
+            Nodes[n].Prev |= delta;
+            for (unsigned o : delta) {
+                // 结点可能在循环中增加，只按下标访问
+                if (Function *F = dyn_cast_or_null<Function>(Sites[o])) {
+                    for (size_t k = 0; k < Nodes[n].Calls.size(); k++) {
+                        CallBase *CB = Nodes[n].Calls[k];
+                        if (!Resolved.insert({CB, F}).second)
+                            continue;
+                        IndirectEdges++;
+                        if (!F->isDeclaration())
+                            Bind_Call(CB, F);
+                        else if (Node_Of(CB) != PTS_NONE)
+                            Addr(Node_Of(CB), Obj(CB));
+                    }
+                }
+                for (size_t k = 0; k < Nodes[n].Loads.size(); k++)
+                    Add_Copy(o, Nodes[n].Loads[k]);
+                for (size_t k = 0; k < Nodes[n].Stores.size(); k++)
+                    Add_Copy(Nodes[n].Stores[k], o);
+            }
+            if (Find(n) != n)
+                continue;
+            SparseBitVector<> succ = Nodes[n].Copy;
+            for (unsigned m : succ) {
+                m = Find(m);
+                if (m == n)
+                    continue;
+                if (Nodes[m].Pts |= delta)
+                    Push(m);
+                // 惰性环检测：传播后两端相同说明可能在环上，每条边只检测一次
+                if (Nodes[m].Pts == Nodes[n].Pts && Checked.insert({n, m}).second) {
+                    Detect(n);
+                    if (Find(n) != n)
+                        break;
+                }
+            }
+        }
+    }
+
+    // 求解后压缩并查集并固定各结点的指向集合，之后的查询只读，可在多个线程中同时调用
+    void Freeze()
+    {
+        Frozen.resize(Nodes.size());
+        for (unsigned n = 0; n < Nodes.size(); n++) {
+            Rep[n] = Find(n);
+            if (Rep[n] == n)
+                for (unsigned o : Nodes[n].Pts)
+                    Frozen[n].push_back(o);
+        }
+        for (auto &kv : ValNode) {
+            if (!kv.first->getType()->isPointerTy())
+                continue;
+            PtsValues++;
+            PtsTotal += Frozen[Rep[kv.second]].size();
+        }
+        Nodes.clear();
+        Checked.clear();
+    }
+
+    void Run(Module &M)
+    {
+        for (GlobalVariable &G : M.globals()) {
+            if (!G.hasInitializer())
+                continue;
+            unsigned n = Node_Of(G.getInitializer());
+            if (n != PTS_NONE)
+                Add_Copy(n, Obj(&G));
+        }
+        for (Function &F : M)
+            if (!F.isDeclaration())
+                for (Instruction &I : instructions(F))
+                    Build_Inst(&I);
+        Solve();
+        Freeze();
+    }
+
+    // 查询：指针p可能指向的对象结点（按编号升序）
+    ArrayRef<unsigned> Objects_Of(Value *p) const
+    {
+        auto it = ValNode.find(p);
+        if (it == ValNode.end())
+            return {};
+        return Frozen[Rep[it->second]];
+    }
+
+    // 对象结点对应的分配点
+    Value *Site(unsigned o) const
+    {
+        return Sites[o];
+    }
+
+    bool Is_Site(Value *v) const
+    {
+        return ObjNode.count(v);
+    }
+
+    // 指针p是否可能指向分配点site
+    bool May_Point(Value *p, Value *site) const
+    {
+        auto it = ObjNode.find(site);
+        if (it == ObjNode.end())
+            return false;
+        ArrayRef<unsigned> objs = Objects_Of(p);
+        return std::binary_search(objs.begin(), objs.end(), it->second);
+    }
+};
+
+// -checker-field-depth: IFDS的内存事实按(基对象, 字段访问路径)区分，路径超过N层时截断；0为字段不敏感
+static cl::opt<unsigned> CheckerFieldDepth("checker-field-depth", cl::init(0),
+        cl::desc("track IFDS memory facts per field access path up to this depth (0 = whole objects)"));
+
+// -checker-implicit: 隐式流，被污染的分支条件污染控制依赖于该分支的指令结果与store目标
+static cl::opt<bool> CheckerImplicit("checker-implicit", cl::init(false),
+        cl::desc("propagate taint along control dependences of tainted branches"));
+
+// F中的控制依赖(分支条件, 受控块)：由后支配树求出，分支块B的各后继沿后支配树上溯、到ipdom(B)之前经过的块都控制依赖于B
+static void Ctrl_Deps(Function &F, std::vector<std::pair<Value *, BasicBlock *>> &out)
+{
+    PostDominatorTree PDT(F);
+    for (BasicBlock &B : F) {
+        Instruction *T = B.getTerminator();
+        Value *cond = nullptr;
+        if (BranchInst *BI = dyn_cast<BranchInst>(T))
+            cond = BI->isConditional() ? BI->getCondition() : nullptr;
+        else if (SwitchInst *SI = dyn_cast<SwitchInst>(T))
+            cond = SI->getCondition();
+        if (!cond || isa<Constant>(cond))
+            continue;
+        DomTreeNode *stop = PDT.getNode(&B) ? PDT.getNode(&B)->getIDom() : nullptr;
+        SmallPtrSet<BasicBlock *, 16> seen;
+        for (BasicBlock *S : successors(&B))
+            for (DomTreeNode *n = PDT.getNode(S); n && n != stop; n = n->getIDom())
+                if (n->getBlock() && seen.insert(n->getBlock()).second)
+                    out.push_back({cond, n->getBlock()});
+    }
+}
+
+#define IFDS_ZERO (0)               // 零事实
+#define IFDS_MAX_FACT (1 << 22)     // 事实的最大个数，与指令编号一起打包进64位的路径边
+
+// IFDS制表求解器（exploded supergraph）
+// 事实为被污染的SSA值，或被污染的内存对象（以指针的底层对象表示）；零事实在污点源处生成污点
+// 污点源为Label_Sources中的函数与shim取数API（按itab下标解码的间接调用）的结果，汇点为入口函数中的条件分支、
+// Sink_Calls中的函数与shim写账本API的实参
+// 内存事实可带对象内的字段访问路径（常量下标的getelementptr序列，编号后复用），表示该字段及其下的内容被污染
+// 路径边<d1, n, d2>：n所在函数入口处d1成立时，执行n之前d2成立
+// 被调函数入口事实到出口事实的摘要在所有调用点间复用，代价为事实数与指令数的多项式
+struct TaintIFDS
+{
+    Function *Entry;
+    const PointsTo *Pts;                                    // 为空时内存对象只按指针的底层对象匹配
+    const ShimTable *Shim;                                  // 模块的shim API调用点
+    std::vector<std::pair<Value *, bool>> Facts;            // 事实 → (值, 是否表示其所指内存)
+    std::vector<unsigned> FactPath;                         // 事实 → 内存对象内的访问路径
+    DenseMap<std::pair<Value *, unsigned>, unsigned> FactIndex; // (值, 0或1 + 访问路径) → 事实
+    std::vector<SmallVector<unsigned, 4>> Paths;            // 访问路径编号 → 字段下标序列，0为整个对象
+    std::map<SmallVector<unsigned, 4>, unsigned> PathIndex;
+    DenseMap<Value *, std::pair<Value *, unsigned>> PathMemo;   // 指针 → (常量下标链的基址, 访问路径)
+    std::vector<Instruction *> Insts;                       // 路径边中的指令编号 → 指令
+    DenseMap<Instruction *, unsigned> InstIndex;
+    std::unordered_set<uint64_t> PathEdges;
+    std::vector<uint64_t> Worklist;
+    DenseMap<std::pair<Instruction *, unsigned>, std::vector<unsigned>> JumpFn;    // (调用点, d2) → 所有d1
+    DenseMap<std::pair<Function *, unsigned>, std::vector<std::pair<Instruction *, unsigned>>> Incoming;   // (被调函数, 入口事实) → (调用点, d2)
+    DenseMap<std::pair<Function *, unsigned>, std::vector<std::pair<Instruction *, unsigned>>> EndSummary; // (函数, 入口事实) → (ret, 出口事实)
+    DenseMap<std::pair<Instruction *, unsigned>, std::vector<unsigned>> Summaries; // 摘要边：(调用点, d2) → 返回后的事实
+    std::unordered_set<uint64_t> SummarySet;
+    SmallPtrSet<Instruction *, 16> Tainted;                 // 被污染的汇点
+    DenseMap<BasicBlock *, SmallVector<Value *, 2>> CtrlConds;  // 块 → 控制它的分支条件，按函数首次访问时求出（-checker-implicit）
+    SmallPtrSet<Function *, 8> CtrlDone;
+    unsigned long SummaryReuse;                             // 调用点直接套用已有出口摘要的次数
+    bool Overflow;
+
+    TaintIFDS(Function *F, const PointsTo *pts, const ShimTable *shim)
+        : Entry(F), Pts(pts), Shim(shim), SummaryReuse(0), Overflow(false)
+    {
+        Facts.push_back({nullptr, false});
+        FactPath.push_back(0);
+        Paths.emplace_back();
+        PathIndex[Paths[0]] = 0;
+    }
+
+    // 调用点是否为污点源（ShimTable::Source），是时out返回带污点的输出
+    static bool Is_Source(const ShimTable *shim, CallBase *CB, unsigned char &out)
+    {
+        return shim->Source(CB, CB->getCalledFunction(), out) != 0;
+    }
+
+    // 调用点是否为汇点（ShimTable::Sink）
+    static bool Is_Sink(const ShimTable *shim, CallBase *CB)
+    {
+        return shim->Sink(CB);
+    }
+
+    // 指针v所指的内存对象，常量（null、undef等）不是对象
+    static Value *Obj(Value *v)
+    {
+        Value *o = getUnderlyingObject(v);
+        if (isa<Constant>(o) && !isa<GlobalVariable>(o))
+            return nullptr;
+        return o;
+    }
+
+    // 指针p可能指向内存对象v：v是p的底层对象，或在p的指向集合中
+    bool Points(Value *p, Value *v)
+    {
+        return Obj(p) == v || (Pts && Pts->May_Point(p, v));
+    }
+
+    // 内存对象v是否在调用边和返回边上原样传递（全局变量，以及指向分析中的分配点）
+    bool Pass_Through(Value *v)
+    {
+        return isa<GlobalVariable>(v) || (Pts && Pts->Is_Site(v));
+    }
+
+    unsigned Fact(Value *v, bool mem, unsigned path = 0)
+    {
+        auto ins = FactIndex.try_emplace({v, mem ? path + 1 : 0}, Facts.size());
+        if (ins.second) {
+            Facts.push_back({v, mem});
+            FactPath.push_back(path);
+        }
+        return ins.first->second;
+    }
+
+    void Gen(SmallVectorImpl<unsigned> &out, Value *v, bool mem, unsigned path = 0)
+    {
+        if (!v)
+            return;
+        if (!mem && !isa<Instruction>(v) && !isa<Argument>(v))
+            return;
+        out.push_back(Fact(v, mem, path));
+    }
+
+    // 访问路径编号，超过-checker-field-depth的部分截断
+    unsigned Intern(ArrayRef<unsigned> path)
+    {
+        SmallVector<unsigned, 4> key(path.begin(), path.begin() + std::min<size_t>(path.size(), CheckerFieldDepth));
+        auto ins = PathIndex.insert({key, (unsigned)Paths.size()});
+        if (ins.second)
+            Paths.push_back(key);
+        return ins.first->second;
+    }
+
+    // 指针p在内存对象v中的访问路径：p由v经首个下标为0的常量下标getelementptr得到时为各字段下标，
+    // 遇到变量下标或指针运算时截断在已有的前缀；bitcast之后的下标按另一类型解释，不计入路径
+    unsigned Path_Of(Value *p, Value *v)
+    {
+        if (!CheckerFieldDepth)
+            return 0;
+        auto it = PathMemo.find(p);
+        if (it != PathMemo.end())
+            return it->second.first == v ? it->second.second : 0;
+        SmallVector<GEPOperator *, 4> geps;
+        Value *base = p;
+        while (true) {
+            if (GEPOperator *G = dyn_cast<GEPOperator>(base)) {
+                geps.push_back(G);
+                base = G->getPointerOperand();
+            } else if (BitCastOperator *BC = dyn_cast<BitCastOperator>(base)) {
+                geps.clear();
+                base = BC->getOperand(0);
+            } else {
+                break;
+            }
+        }
+        SmallVector<unsigned, 4> path;
+        for (auto g = geps.rbegin(); g != geps.rend(); ++g) {
+            auto idx = (*g)->idx_begin();
+            ConstantInt *first = dyn_cast<ConstantInt>(*idx);
+            if (!first || !first->isZero())
+                break;
+            bool whole = true;
+            for (++idx; idx != (*g)->idx_end(); ++idx) {
+                ConstantInt *C = dyn_cast<ConstantInt>(*idx);
+                if (!C) {
+                    whole = false;
+                    break;
+                }
+                path.push_back(C->getZExtValue());
+            }
+            if (!whole)
+                break;
+        }
+        unsigned id = Intern(path);
+        PathMemo[p] = {base, id};
+        return base == v ? id : 0;
+    }
+
+    // 路径a所指的区域是否包含路径b
+    bool Prefix(unsigned a, unsigned b)
+    {
+        const SmallVector<unsigned, 4> &A = Paths[a], &B = Paths[b];
+        return A.size() <= B.size() && std::equal(A.begin(), A.end(), B.begin());
+    }
+
+    bool Overlap(unsigned a, unsigned b)
+    {
+        return Prefix(a, b) || Prefix(b, a);
+    }
+
+    // 对象内路径q上的污点，相对于对象内路径为p的指针所指区域的路径；不相交时为PTS_NONE
+    unsigned Rebase(unsigned p, unsigned q)
+    {
+        if (Prefix(p, q)) {
+            SmallVector<unsigned, 4> sub(Paths[q].begin() + Paths[p].size(), Paths[q].end());
+            return Intern(sub);
+        }
+        return Prefix(q, p) ? 0 : PTS_NONE;
+    }
+
+    unsigned Append(unsigned p, unsigned q)
+    {
+        if (!q)
+            return p;
+        SmallVector<unsigned, 4> path(Paths[p].begin(), Paths[p].end());
+        path.append(Paths[q].begin(), Paths[q].end());
+        return Intern(path);
+    }
+
+    // p可能指向的所有内存对象，sub为p所指区域内被污染的路径；指向分析给出的对象不知道p在其中的位置，按整个对象处理
+    void Gen_Objs(SmallVectorImpl<unsigned> &out, Value *p, unsigned sub = 0)
+    {
+        Value *o = Obj(p);
+        if (o)
+            Gen(out, o, true, Append(Path_Of(p, o), sub));
+        if (!Pts)
+            return;
+        for (unsigned k : Pts->Objects_Of(p))
+            if (!isa<Function>(Pts->Site(k)) && Pts->Site(k) != o)
+                Gen(out, Pts->Site(k), true);
+    }
+
+    static bool Is_Defined_Call(Instruction *I, Function *&callee)
+    {
+        CallBase *CB = dyn_cast<CallBase>(I);
+        callee = CB ? CB->getCalledFunction() : nullptr;
+        return callee && !callee->isDeclaration();
+    }
+
+    void Succs(Instruction *n, SmallVectorImpl<Instruction *> &out)
+    {
+        if (!n->isTerminator()) {
+            out.push_back(n->getNextNode());
+            return;
+        }
+        for (unsigned k = 0; k < n->getNumSuccessors(); k++)
+            out.push_back(&n->getSuccessor(k)->front());
+    }
+
+    void Propagate(unsigned d1, Instruction *n, unsigned d2)
+    {
+        auto ins = InstIndex.try_emplace(n, Insts.size());
+        if (ins.second)
+            Insts.push_back(n);
+        if (Insts.size() >= MAX_INST || Facts.size() >= IFDS_MAX_FACT) {
+            Overflow = true;
+            return;
+        }
+        uint64_t key = ((uint64_t)ins.first->second << 44) | ((uint64_t)d1 << 22) | d2;
+        if (!PathEdges.insert(key).second)
+            return;
+        Worklist.push_back(key);
+        Function *callee;
+        if (Is_Defined_Call(n, callee))
+            JumpFn[{n, d2}].push_back(d1);
+    }
+
+    // I所在块是否控制依赖于以cond为条件的分支；控制依赖每个函数只求一次，之后只是查表
+    bool Controlled(Value *cond, Instruction *I)
+    {
+        Function *F = I->getFunction();
+        if (CtrlDone.insert(F).second) {
+            std::vector<std::pair<Value *, BasicBlock *>> deps;
+            Ctrl_Deps(*F, deps);
+            for (auto &dep : deps)
+                CtrlConds[dep.second].push_back(dep.first);
+        }
+        auto it = CtrlConds.find(I->getParent());
+        return it != CtrlConds.end() && is_contained(it->second, cond);
+    }
+
+    // 普通指令的流函数：恒等，再加上由d生成的事实
+    void Flow(Instruction *I, unsigned d, SmallVectorImpl<unsigned> &out)
+    {
+        out.push_back(d);
+        if (d == IFDS_ZERO) {
+            CallBase *CB = dyn_cast<CallBase>(I);
+            unsigned char src_out;
+            if (!CB || !Is_Source(Shim, CB, src_out))
+                return;
+            if (!I->getType()->isVoidTy()) {
+                Gen(out, I, false);
+                if (I->getType()->isPointerTy())
+                    Gen(out, I, true);
+            }
+            for (unsigned j = 0; j < CB->arg_size(); j++)
+                if (CB->paramHasAttr(j, Attribute::StructRet) || (src_out == LABEL_OUT_LAST && j + 1 == CB->arg_size()))
+                    Gen_Objs(out, CB->getArgOperand(j));
+            return;
+        }
+        Value *v = Facts[d].first;
+        bool mem = Facts[d].second;
+        unsigned path = FactPath[d];
+        if (CheckerImplicit && !mem && Controlled(v, I)) {
+            if (StoreInst *SI = dyn_cast<StoreInst>(I))
+                Gen_Objs(out, SI->getPointerOperand());
+            else if (!I->getType()->isVoidTy())
+                Gen(out, I, false);
+        }
+        if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+            Value *ptr = LI->getPointerOperand();
+            if ((!mem && ptr == v) || (mem && Points(ptr, v) && Overlap(Path_Of(ptr, v), path))) {
+                Gen(out, LI, false);
+                if (LI->getType()->isPointerTy())
+                    Gen(out, LI, true);
+            }
+        } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+            Value *val = SI->getValueOperand();
+            if ((!mem && val == v) || (mem && val->getType()->isPointerTy() && Points(val, v) && Overlap(Path_Of(val, v), path)))
+                Gen_Objs(out, SI->getPointerOperand());
+        } else if (MemTransferInst *MT = dyn_cast<MemTransferInst>(I)) {
+            Value *src = MT->getRawSource();
+            if (mem && Points(src, v) && Overlap(Path_Of(src, v), path))
+                Gen_Objs(out, MT->getRawDest(), Rebase(Path_Of(src, v), path));
+        } else if (MemSetInst *MS = dyn_cast<MemSetInst>(I)) {
+            if (!mem && MS->getValue() == v)
+                Gen_Objs(out, MS->getRawDest());
+        } else if (isa<CallBase>(I)) {
+            // 无定义的被调函数与stain相同，不传播污点
+        } else if (!mem && !I->getType()->isVoidTy()) {
+            for (Value *op : I->operands())
+                if (op == v) {
+                    Gen(out, I, false);
+                    break;
+                }
+        }
+    }
+
+    // 调用边：实参 → 形参，全局变量原样进入被调函数
+    void Call_Flow(CallBase *CB, Function *callee, unsigned d, SmallVectorImpl<unsigned> &out)
+    {
+        if (d == IFDS_ZERO) {
+            out.push_back(d);
+            return;
+        }
+        Value *v = Facts[d].first;
+        bool mem = Facts[d].second;
+        unsigned path = FactPath[d];
+        for (unsigned j = 0; j < CB->arg_size() && j < callee->arg_size(); j++) {
+            Value *actual = CB->getArgOperand(j);
+            if (!mem && actual == v)
+                Gen(out, callee->getArg(j), false);
+            else if (mem && actual->getType()->isPointerTy() && Points(actual, v)) {
+                unsigned sub = Rebase(Path_Of(actual, v), path);
+                if (sub != PTS_NONE)
+                    Gen(out, callee->getArg(j), true, sub);
+            }
+        }
+        if (mem && Pass_Through(v))
+            out.push_back(d);
+    }
+
+    // 返回边：返回值 → 调用结果，形参所指内存 → 实参所指内存，全局变量原样返回
+    void Ret_Flow(CallBase *CB, ReturnInst *RI, unsigned d, SmallVectorImpl<unsigned> &out)
+    {
+        if (d == IFDS_ZERO)
+            return;
+        Value *v = Facts[d].first;
+        bool mem = Facts[d].second;
+        Value *ret = RI->getReturnValue();
+        if (ret && !mem && ret == v)
+            Gen(out, CB, false);
+        if (!mem)
+            return;
+        unsigned path = FactPath[d];
+        if (ret && ret->getType()->isPointerTy() && Points(ret, v)) {
+            unsigned sub = Rebase(Path_Of(ret, v), path);
+            if (sub != PTS_NONE)
+                Gen(out, CB, true, sub);
+        }
+        if (Argument *A = dyn_cast<Argument>(v))
+            if (A->getArgNo() < CB->arg_size() && CB->getArgOperand(A->getArgNo())->getType()->isPointerTy())
+                Gen_Objs(out, CB->getArgOperand(A->getArgNo()), path);
+        if (Pass_Through(v))
+            out.push_back(d);
+    }
+
+    bool Add_Summary(Instruction *c, unsigned d2, unsigned d5)
+    {
+        uint64_t key = ((uint64_t)InstIndex[c] << 44) | ((uint64_t)d2 << 22) | d5;
+        if (!SummarySet.insert(key).second)
+            return false;
+        Summaries[{c, d2}].push_back(d5);
+        return true;
+    }
+
+    // 入口函数中的汇点
+    void Check_Sink(Instruction *n, unsigned d)
+    {
+        if (d == IFDS_ZERO || n->getFunction() != Entry)
+            return;
+        Value *v = Facts[d].first;
+        bool mem = Facts[d].second;
+        if (BranchInst *BI = dyn_cast<BranchInst>(n)) {
+            if (BI->isConditional() && !mem && BI->getCondition() == v)
+                Tainted.insert(n);
+        } else if (SwitchInst *SI = dyn_cast<SwitchInst>(n)) {
+            if (!mem && SI->getCondition() == v)
+                Tainted.insert(n);
+        } else if (CallBase *CB = dyn_cast<CallBase>(n)) {
+            if (!Is_Sink(Shim, CB))
+                return;
+            for (Value *arg : CB->args())
+                if ((!mem && arg == v) || (mem && arg->getType()->isPointerTy() && Points(arg, v) && Overlap(Path_Of(arg, v), FactPath[d])))
+                    Tainted.insert(n);
+        }
+    }
+
+    void Solve()
+    {
+        Instruction *start = &Entry->getEntryBlock().front();
+        Propagate(IFDS_ZERO, start, IFDS_ZERO);
+        // 第0个参数是sret时为入口函数的返回值，不是输入
+        if (Entry->arg_size() && !Entry->hasStructRetAttr()) {
+            Propagate(IFDS_ZERO, start, Fact(Entry->getArg(0), false));
+            if (Entry->getArg(0)->getType()->isPointerTy())
+                Propagate(IFDS_ZERO, start, Fact(Entry->getArg(0), true));
+        }
+        while (!Worklist.empty() && !Overflow) {
+            uint64_t key = Worklist.back();
+            Worklist.pop_back();
+            Instruction *n = Insts[key >> 44];
+            unsigned d1 = (key >> 22) & (IFDS_MAX_FACT - 1), d2 = key & (IFDS_MAX_FACT - 1);
+            Check_Sink(n, d2);
+            SmallVector<Instruction *, 2> succs;
+            SmallVector<unsigned, 4> out;
+            Function *callee;
+            if (Is_Defined_Call(n, callee)) {
+                CallBase *CB = cast<CallBase>(n);
+                Instruction *callee_start = &callee->getEntryBlock().front();
+                Call_Flow(CB, callee, d2, out);
+                for (unsigned d3 : out) {
+                    Propagate(d3, callee_start, d3);
+                    Incoming[{callee, d3}].push_back({n, d2});
+                    auto it = EndSummary.find({callee, d3});
+                    if (it == EndSummary.end())
+                        continue;
+                    SummaryReuse++;
+                    for (auto &exit : it->second) {
+                        SmallVector<unsigned, 4> rets;
+                        Ret_Flow(CB, cast<ReturnInst>(exit.first), exit.second, rets);
+                        for (unsigned d5 : rets)
+                            Add_Summary(n, d2, d5);
+                    }
+                }
+                Succs(n, succs);
+                out.clear();
+                out.push_back(d2);
+                auto sum = Summaries.find({n, d2});
+                if (sum != Summaries.end())
+                    out.append(sum->second.begin(), sum->second.end());
+                for (Instruction *m : succs)
+                    for (unsigned d3 : out)
+                        Propagate(d1, m, d3);
+            } else if (ReturnInst *RI = dyn_cast<ReturnInst>(n)) {
+                Function *p = n->getFunction();
+                EndSummary[{p, d1}].push_back({n, d2});
+                auto it = Incoming.find({p, d1});
+                if (it == Incoming.end())
+                    continue;
+                std::vector<std::pair<Instruction *, unsigned>> callers = it->second;
+                for (auto &c : callers) {
+                    SmallVector<unsigned, 4> rets;
+                    Ret_Flow(cast<CallBase>(c.first), RI, d2, rets);
+                    for (unsigned d5 : rets) {
+                        if (!Add_Summary(c.first, c.second, d5))
+                            continue;
+                        SmallVector<Instruction *, 2> next;
+                        Succs(c.first, next);
+                        std::vector<unsigned> d3s = JumpFn[{c.first, c.second}];
+                        for (Instruction *m : next)
+                            for (unsigned d3 : d3s)
+                                Propagate(d3, m, d5);
+                    }
+                }
+            } else {
+                Flow(n, d2, out);
+                Succs(n, succs);
+                for (Instruction *m : succs)
+                    for (unsigned d3 : out)
+                        Propagate(d1, m, d3);
+            }
+        }
+    }
+};
+
+// Steensgaard风格的合一指针分析：每个等价类至多指向一个等价类，赋值两端所指的类合并，整体近似线性
+// 在此之上对值与内存等价类做一次流不敏感、上下文不敏感的污点可达遍历，规则覆盖TaintIFDS的流函数，
+// 因此判为不可达的入口函数IFDS也不会报告，可以直接排除
+struct TaintTriage
+{
+    std::vector<unsigned> Rep;
+    std::vector<unsigned> Size;
+    std::vector<unsigned> Pointee;                      // 类 → 所指的类，PTS_NONE表示尚未指向任何类
+    DenseMap<Value *, unsigned> ValNode;
+    DenseMap<Function *, unsigned> RetNode;
+    DenseMap<Type *, bool> PtrTypes;
+    DenseMap<Function *, std::vector<CallBase *>> Callers;      // 函数 → 直接调用点
+    DenseMap<unsigned, std::vector<Instruction *>> ClassUsers;  // 内存类 → 读该类的load与memcpy、存入指向该类的指针的store
+    DenseMap<Value *, std::vector<BasicBlock *>> CtrlBlocks;    // 分支条件 → 受控块（-checker-implicit）
+    const ShimTable *Shim;                              // 源与汇点同TaintIFDS，含按itab下标解码的shim API
+    unsigned long Classes;
+
+    TaintTriage(const ShimTable *shim) : Shim(shim), Classes(0) {}
+
+    unsigned New_Node()
+    {
+        Rep.push_back(Rep.size());
+        Size.push_back(1);
+        Pointee.push_back(PTS_NONE);
+        Classes++;
+        return Rep.size() - 1;
+    }
+
+    unsigned Find(unsigned n)
+    {
+        while (Rep[n] != n) {
+            Rep[n] = Rep[Rep[n]];
+            n = Rep[n];
+        }
+        return n;
+    }
+
+    // 合并两个类，所指的类随之合并
+    void Join(unsigned a, unsigned b)
+    {
+        SmallVector<std::pair<unsigned, unsigned>, 8> work;
+        work.push_back({a, b});
+        while (!work.empty()) {
+            std::pair<unsigned, unsigned> w = work.pop_back_val();
+            unsigned x = Find(w.first), y = Find(w.second);
+            if (x == y)
+                continue;
+            if (Size[x] < Size[y])
+                std::swap(x, y);
+            Rep[y] = x;
+            Size[x] += Size[y];
+            Classes--;
+            if (Pointee[x] == PTS_NONE)
+                Pointee[x] = Pointee[y];
+            else if (Pointee[y] != PTS_NONE)
+                work.push_back({Pointee[x], Pointee[y]});
+        }
+    }
+
+    // n所指的类，没有时新建
+    unsigned Deref(unsigned n)
+    {
+        n = Find(n);
+        if (Pointee[n] == PTS_NONE) {
+            unsigned c = New_Node();
+            Pointee[n] = c;
+        }
+        return Find(Pointee[n]);
+    }
+
+    unsigned Node_Of(Value *v)
+    {
+        auto it = ValNode.find(v);
+        if (it != ValNode.end())
+            return it->second;
+        unsigned n;
+        if (isa<GlobalValue>(v)) {
+            n = New_Node();
+            ValNode[v] = n;
+            Deref(n);
+            return n;
+        }
+        if (Constant *C = dyn_cast<Constant>(v)) {
+            if (isa<ConstantData>(C) || isa<BlockAddress>(C))
+                return PTS_NONE;
+            n = New_Node();
+            ValNode[v] = n;
+            for (Value *op : C->operands()) {
+                unsigned m = Node_Of(op);
+                if (m != PTS_NONE)
+                    Join(Deref(n), Deref(m));
+            }
+            return n;
+        }
+        if ((isa<Instruction>(v) || isa<Argument>(v)) && (Has_Ptr(v->getType(), PtrTypes) || isa<PtrToIntInst>(v))) {
+            n = New_Node();
+            ValNode[v] = n;
+            return n;
+        }
+        return PTS_NONE;
+    }
+
+    // x = y：两者所指的类合并
+    void Assign(Value *x, Value *y)
+    {
+        unsigned a = Node_Of(x), b = Node_Of(y);
+        if (a != PTS_NONE && b != PTS_NONE)
+            Join(Deref(a), Deref(b));
+    }
+
+    static Function *Callee(CallBase *CB)
+    {
+        return dyn_cast<Function>(CB->getCalledOperand()->stripPointerCasts());
+    }
+
+    void Build_Inst(Instruction *I)
+    {
+        unsigned n;
+        if (isa<AllocaInst>(I)) {
+            Deref(Node_Of(I));
+        } else if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+            unsigned p = Node_Of(LI->getPointerOperand());
+            if ((n = Node_Of(I)) != PTS_NONE && p != PTS_NONE)
+                Join(Deref(n), Deref(Deref(p)));
+        } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+            unsigned p = Node_Of(SI->getPointerOperand());
+            if ((n = Node_Of(SI->getValueOperand())) != PTS_NONE && p != PTS_NONE)
+                Join(Deref(Deref(p)), Deref(n));
+        } else if (CallBase *CB = dyn_cast<CallBase>(I)) {
+            Function *callee = Callee(CB);
+            if (MemTransferInst *MT = dyn_cast<MemTransferInst>(CB)) {
+                unsigned src = Node_Of(MT->getRawSource()), dst = Node_Of(MT->getRawDest());
+                if (src != PTS_NONE && dst != PTS_NONE)
+                    Join(Deref(Deref(dst)), Deref(Deref(src)));
+            } else if (callee && !callee->isDeclaration()) {
+                Callers[callee].push_back(CB);
+                for (unsigned j = 0; j < CB->arg_size() && j < callee->arg_size(); j++)
+                    Assign(callee->getArg(j), CB->getArgOperand(j));
+                if ((n = Node_Of(CB)) != PTS_NONE) {
+                    auto ins = RetNode.try_emplace(callee, 0);
+                    if (ins.second)
+                        ins.first->second = New_Node();
+                    Join(Deref(n), Deref(RetNode[callee]));
+                }
+            } else if ((n = Node_Of(CB)) != PTS_NONE) {
+                Deref(n);
+            }
+        } else if (ReturnInst *RI = dyn_cast<ReturnInst>(I)) {
+            if (RI->getReturnValue() && (n = Node_Of(RI->getReturnValue())) != PTS_NONE) {
+                auto ins = RetNode.try_emplace(I->getFunction(), 0);
+                if (ins.second)
+                    ins.first->second = New_Node();
+                Join(Deref(n), Deref(RetNode[I->getFunction()]));
+            }
+        } else if (Node_Of(I) != PTS_NONE) {
+            for (Value *op : I->operands())
+                Assign(I, op);
+        }
+    }
+
+    // 指针p所指的内存类；建好后只读
+    unsigned Mem(Value *p) const
+    {
+        auto it = ValNode.find(p);
+        if (it == ValNode.end())
+            return PTS_NONE;
+        unsigned q = Pointee[Rep[it->second]];
+        return q == PTS_NONE ? PTS_NONE : Rep[q];
+    }
+
+    void Run(Module &M)
+    {
+        for (GlobalVariable &G : M.globals())
+            if (G.hasInitializer())
+                Assign(&G, G.getInitializer());
+        for (Function &F : M)
+            if (!F.isDeclaration())
+                for (Instruction &I : instructions(F))
+                    Build_Inst(&I);
+        // 压缩并查集，之后的查询只读，可在多个线程中同时调用
+        for (unsigned n = 0; n < Rep.size(); n++)
+            Rep[n] = Find(n);
+        for (Function &F : M) {
+            if (F.isDeclaration())
+                continue;
+            for (Instruction &I : instructions(F)) {
+                unsigned c = PTS_NONE;
+                if (LoadInst *LI = dyn_cast<LoadInst>(&I))
+                    c = Mem(LI->getPointerOperand());
+                else if (MemTransferInst *MT = dyn_cast<MemTransferInst>(&I))
+                    c = Mem(MT->getRawSource());
+                else if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+                    c = SI->getValueOperand()->getType()->isPointerTy() ? Mem(SI->getValueOperand()) : PTS_NONE;
+                if (c != PTS_NONE)
+                    ClassUsers[c].push_back(&I);
+            }
+            if (CheckerImplicit) {
+                std::vector<std::pair<Value *, BasicBlock *>> deps;
+                Ctrl_Deps(F, deps);
+                for (auto &dep : deps)
+                    CtrlBlocks[dep.first].push_back(dep.second);
+            }
+        }
+    }
+
+    // 入口函数F的污点源是否可能到达其汇点，可能被污染的汇点写入hits
+    // visited返回遍历到的值与内存类个数
+    void Reach(Function *F, SmallVectorImpl<Instruction *> &hits, unsigned long &visited) const
+    {
+        DenseSet<Value *> vals;
+        DenseSet<unsigned> mems;
+        std::vector<Value *> vwork;
+        std::vector<unsigned> mwork;
+        auto taint_val = [&](Value *v) {
+            if (vals.insert(v).second)
+                vwork.push_back(v);
+        };
+        auto taint_mem = [&](Value *p) {
+            unsigned c = Mem(p);
+            if (c != PTS_NONE && mems.insert(c).second)
+                mwork.push_back(c);
+        };
+        // 污点源：入口参数（sret除外），以及从F经直接调用可达的函数中的源调用
+        if (F->arg_size() && !F->hasStructRetAttr()) {
+            taint_val(F->getArg(0));
+            taint_mem(F->getArg(0));
+        }
+        SmallPtrSet<Function *, 32> reach;
+        SmallVector<Function *, 32> stack;
+        reach.insert(F);
+        stack.push_back(F);
+        while (!stack.empty()) {
+            Function *fn = stack.pop_back_val();
+            for (Instruction &I : instructions(fn)) {
+                CallBase *CB = dyn_cast<CallBase>(&I);
+                if (!CB)
+                    continue;
+                Function *callee = Callee(CB);
+                if (callee && !callee->isDeclaration() && reach.insert(callee).second)
+                    stack.push_back(callee);
+                unsigned char src_out;
+                if (!TaintIFDS::Is_Source(Shim, CB, src_out))
+                    continue;
+                if (!CB->getType()->isVoidTy()) {
+                    taint_val(CB);
+                    taint_mem(CB);
+                }
+                for (unsigned j = 0; j < CB->arg_size(); j++)
+                    if (CB->paramHasAttr(j, Attribute::StructRet) || (src_out == LABEL_OUT_LAST && j + 1 == CB->arg_size()))
+                        taint_mem(CB->getArgOperand(j));
+            }
+        }
+        while (!vwork.empty() || !mwork.empty()) {
+            while (!vwork.empty()) {
+                Value *v = vwork.back();
+                vwork.pop_back();
+                auto ctrl = CtrlBlocks.find(v);
+                if (ctrl != CtrlBlocks.end())
+                    for (BasicBlock *X : ctrl->second)
+                        for (Instruction &I : *X) {
+                            if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+                                taint_mem(SI->getPointerOperand());
+                            else if (!I.getType()->isVoidTy())
+                                taint_val(&I);
+                        }
+                for (User *u : v->users()) {
+                    Instruction *I = dyn_cast<Instruction>(u);
+                    if (!I)
+                        continue;
+                    if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+                        if (LI->getPointerOperand() == v)
+                            taint_val(LI);
+                    } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+                        if (SI->getValueOperand() == v)
+                            taint_mem(SI->getPointerOperand());
+                    } else if (MemSetInst *MS = dyn_cast<MemSetInst>(I)) {
+                        if (MS->getValue() == v)
+                            taint_mem(MS->getRawDest());
+                    } else if (CallBase *CB = dyn_cast<CallBase>(I)) {
+                        Function *callee = Callee(CB);
+                        if (!callee || callee->isDeclaration())
+                            continue;
+                        for (unsigned j = 0; j < CB->arg_size() && j < callee->arg_size(); j++)
+                            if (CB->getArgOperand(j) == v)
+                                taint_val(callee->getArg(j));
+                    } else if (isa<ReturnInst>(I)) {
+                        auto it = Callers.find(I->getFunction());
+                        if (it != Callers.end())
+                            for (CallBase *CB : it->second)
+                                taint_val(CB);
+                    } else if (!I->getType()->isVoidTy()) {
+                        taint_val(I);
+                    }
+                }
+            }
+            while (!mwork.empty()) {
+                unsigned c = mwork.back();
+                mwork.pop_back();
+                auto it = ClassUsers.find(c);
+                if (it == ClassUsers.end())
+                    continue;
+                for (Instruction *I : it->second) {
+                    if (isa<LoadInst>(I)) {
+                        taint_val(I);
+                        if (I->getType()->isPointerTy())
+                            taint_mem(I);
+                    } else if (MemTransferInst *MT = dyn_cast<MemTransferInst>(I)) {
+                        taint_mem(MT->getRawDest());
+                    } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+                        taint_mem(SI->getPointerOperand());
+                    }
+                }
+            }
+        }
+        visited = vals.size() + mems.size();
+        // 汇点与TaintIFDS::Check_Sink相同
+        for (Instruction &I : instructions(F)) {
+            if (BranchInst *BI = dyn_cast<BranchInst>(&I)) {
+                if (BI->isConditional() && vals.count(BI->getCondition()))
+                    hits.push_back(&I);
+            } else if (SwitchInst *SI = dyn_cast<SwitchInst>(&I)) {
+                if (vals.count(SI->getCondition()))
+                    hits.push_back(&I);
+            } else if (CallBase *CB = dyn_cast<CallBase>(&I)) {
+                if (!TaintIFDS::Is_Sink(Shim, CB))
+                    continue;
+                for (Value *arg : CB->args())
+                    if (vals.count(arg) || (arg->getType()->isPointerTy() && Mem(arg) != PTS_NONE && mems.count(Mem(arg)))) {
+                        hits.push_back(&I);
+                        break;
+                    }
+            }
+        }
+    }
+};
+
 //记录function的所有信息
 struct funVal
 {
@@ -63,6 +1366,9 @@ namespace {
     struct checker : public ModulePass {
         
         static char ID;
+        std::unique_ptr<PointsTo> pts;      // -checker-pts时整个模块的指向分析结果，各入口函数共享
+        std::unique_ptr<TaintTriage> triage;    // -checker-tier=fast/tiered时的合一指针分析，各入口函数共享
+        ShimTable shim;                     // 模块中的shim API调用点，各入口函数、各FPL规则与污点源、汇点共享
         checker() : ModulePass(ID) {}
 
         // 初始化Invoke函数的数据成员
@@ -91,51 +1397,159 @@ namespace {
 
         }
 
-        // detect FPL1.1
-        void FPL11(Function *F){
-            StringRef const shim = "i8* %stub.chunk0";
-            StringRef const get_private = "i32 12";
-            StringRef const get_transient = "i32 28";
-            StringRef const put_private = "i32 33";
-            bool is_shim = 0, has_put_private = 0, has_get_transient = 0;
+        // 入口函数中的隐私读取
+        // 只读取IR和模块的shim调用表，检测结果写入os，可在多个线程中对不同入口函数同时调用
+        void Privacy_Reads(Function *F, raw_ostream &os)
+        {
+            for (const ShimCall &call : shim.Find(F))
+                if (call.Api == SHIM_GET_PRIVATE_DATA)
+                    os << "find privacy read: " << *call.Gep << "\n";
+        }
 
-            for (BasicBlock &B : *F) {
-                for (Instruction &I: B) {
-                    if (I.getOpcode() == Instruction :: GetElementPtr) {
-                        Value *arg = I.getOperand(I.getNumOperands() - 1);
-                        std::string api;
-                        raw_string_ostream(api) << *arg;
-                        if (api == get_private) {
-                            errs()<< "find privacy read: " << I << "\n";
-                        }
-                    }
+        // detect FPL1.1: 存在PutPrivateData(33)不存在GetTransient(28)
+        bool FPL11(Function *F) const
+        {
+            bool has_put_private = 0, has_get_transient = 0;
+
+            for (const ShimCall &call : shim.Find(F)) {
+                has_put_private |= call.Api == SHIM_PUT_PRIVATE_DATA;
+                has_get_transient |= call.Api == SHIM_GET_TRANSIENT;
+            }
+            return has_put_private && !has_get_transient;
+        }
+
+        // IFDS求解器：报告入口函数中被污染的汇点及求解规模
+        void IFDS(Function *F, raw_ostream &os)
+        {
+            auto start = std::chrono::steady_clock::now();
+            TaintIFDS solver(F, pts.get(), &shim);
+            solver.Solve();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            for (Instruction &I : instructions(F)) {
+                if (solver.Tainted.count(&I))
+                    os << "ifds tainted sink: " << I << "\n";
+            }
+            if (solver.Overflow)
+                os << "ifds: fact or instruction limit reached, result incomplete\n";
+            os << "ifds: " << solver.Tainted.size() << " tainted sinks, " << solver.Facts.size() << " facts, "
+               << solver.PathEdges.size() << " path edges, " << solver.SummarySet.size() << " summary edges ("
+               << solver.SummaryReuse << " reused), ";
+            if (CheckerFieldDepth)
+                os << solver.Paths.size() << " access paths, ";
+            os << format("%.2f", ms) << " ms\n";
+        }
+
+        // 粗粒度检查：返回源与汇点是否可能相连
+        bool Triage(Function *F, raw_ostream &os)
+        {
+            auto start = std::chrono::steady_clock::now();
+            SmallVector<Instruction *, 8> hits;
+            unsigned long visited;
+            triage->Reach(F, hits, visited);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            for (Instruction *I : hits)
+                os << "fast possible sink: " << *I << "\n";
+            os << "fast: " << hits.size() << " possible sinks, " << visited << " values and memory classes visited, "
+               << format("%.2f", ms) << " ms\n";
+            return !hits.empty();
+        }
+
+        // 污点分析按-checker-tier分层，报告记录由哪一层给出结论
+        void Analyse(Function *F, raw_ostream &os)
+        {
+            Privacy_Reads(F, os);
+            if (CheckerTierMode == TIER_PRECISE) {
+                if (CheckerIFDS) {
+                    IFDS(F, os);
+                    os << "tier: precise\n";
+                }
+                return;
+            }
+            bool possible = Triage(F, os);
+            // 入口函数自身调用了shim API时不以快速检查的结论排除，总交给IFDS
+            bool stub = !shim.Find(F).empty();
+            if (CheckerTierMode == TIER_FAST || (!possible && !stub)) {
+                os << "tier: fast" << (possible ? "" : ", no source can reach a sink") << "\n";
+                return;
+            }
+            IFDS(F, os);
+            os << "tier: precise, escalated by " << (possible ? "fast check" : "shim API call") << "\n";
+        }
+
+        // 分析所有入口函数，每个入口的报告写入各自的reports[i]，按入口顺序输出，结果与线程数无关
+        void AnalyseEntries(std::vector<Function *> &entries, std::vector<std::string> &reports)
+        {
+            unsigned threads = CheckerThreads ? CheckerThreads : hardware_concurrency().compute_thread_count();
+            if (threads <= 1 || entries.size() <= 1) {
+                for (size_t i = 0; i < entries.size(); i++) {
+                    raw_string_ostream os(reports[i]);
+                    Analyse(entries[i], os);
                 }
+                return;
+            }
+            ThreadPool pool(hardware_concurrency(threads));
+            std::atomic<size_t> next(0);
+            for (unsigned t = 0; t < threads; t++) {
+                pool.async([&] {
+                    for (size_t i; (i = next++) < entries.size();) {
+                        raw_string_ostream os(reports[i]);
+                        Analyse(entries[i], os);
+                    }
+                });
             }
-            // if (has_put_private && !has_get_transient){
-            //     return true;
-            // } else {
-            //     return false;
-            // }
+            pool.wait();
         }
 
         bool runOnModule(Module &M) {
             bool isChaincode = false;
+            std::vector<Function *> entries;
             for (Function &F:M) {
-                if (F.getName().contains("getPrivate")) {
+                if (F.getName().contains(CheckerEntry)) {
                     isChaincode = true;
-                    errs() << "------Detection start------\n";
-                    FPL11(&F);
+                    entries.push_back(&F);
                 }
-                // else {
-                //     errs() << "FPL1.1 detected in function: \t";
-                //     errs() << F.getName() << "\n";
-                //     errs() << "please get private argument via getTransient \n";
-
-                // }
             }
             if (!isChaincode) { 
-                errs() << "------Detection end, Invoke function not found------\n";
+                errs() << "------Detection end, entry function " << CheckerEntry << " not found------\n";
+                return false;
+            }
+            // 模块级分析只在找到入口函数后建立，其统计放在各入口函数的报告之后输出
+            std::string stats;
+            raw_string_ostream os(stats);
+            shim.Build(M);
+            if (CheckerPts) {
+                auto start = std::chrono::steady_clock::now();
+                pts.reset(new PointsTo());
+                pts->Run(M);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                os << "points-to: " << pts->Sites.size() << " nodes, " << pts->Objects << " objects, "
+                   << pts->Constraints << " constraints, " << pts->Collapsed << " nodes collapsed in "
+                   << pts->CycleRuns << " cycle checks, " << pts->IndirectEdges << " indirect call edges, avg "
+                   << format("%.1f", pts->PtsValues ? (double)pts->PtsTotal / pts->PtsValues : 0.0)
+                   << " objects per pointer, " << format("%.2f", ms) << " ms\n";
             }
+            if (CheckerTierMode != TIER_PRECISE) {
+                auto start = std::chrono::steady_clock::now();
+                triage.reset(new TaintTriage(&shim));
+                triage->Run(M);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                os << "unification alias: " << triage->Rep.size() << " nodes in " << triage->Classes << " classes, "
+                   << format("%.2f", ms) << " ms\n";
+            }
+            std::vector<std::string> reports(entries.size());
+            AnalyseEntries(entries, reports);
+            for (std::string &report : reports) {
+                errs() << "------Detection start------\n";
+                errs() << report;
+            }
+            // FPL1.1检查模块中的每个函数，不限于入口函数
+            for (Function &F : M)
+                if (FPL11(&F)) {
+                    errs() << "FPL1.1 detected in function: \t";
+                    errs() << F.getName() << "\n";
+                    errs() << "please get private argument via getTransient \n";
+                }
+            errs() << os.str();
             return false;
         }
     }; // end of struct Hello
@@ -0,0 +1,93 @@
+#!/bin/bash
+# 在样例上运行stain与checker，检查输出中含有期望的行
+# 用法: fixtures/check.sh    环境变量: CXX 编译器
+# 每个检查: check <stain|checker> <输入.ll> <期望输出（grep -E）> [opt参数...]
+
+set -u
+dir=$(cd "$(dirname "$0")" && pwd)
+src=$(dirname "$dir")
+data=$(dirname "$src")/testData
+CXX=${CXX:-$(command -v clang++ || echo c++)}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+for p in origion checker; do
+	$CXX -O2 $(llvm-config --cxxflags) -fno-rtti -fPIC -shared "$src/$p.cpp" -o "$work/$p.so" \
+		$(llvm-config --ldflags) -lpthread || exit 2
+done
+
+pass=0; fail=0
+check()
+{
+	local pass_name=$1 input=$2 want=$3 so=$work/origion.so
+	shift 3
+	[ "$pass_name" = checker ] && so=$work/checker.so
+	opt -load "$so" -$pass_name "$@" -enable-new-pm=0 -disable-output "$input" > "$work/out" 2>&1
+	if grep -Eq "$want" "$work/out"; then
+		pass=$((pass + 1))
+	else
+		fail=$((fail + 1))
+		echo "FAIL: -$pass_name $* $(basename "$input"): expected /$want/"
+	fi
+}
+
+# 两组参数下的输出相同：same <stain|checker> <输入.ll> "<参数1>" "<参数2>"
+# 去掉耗时与线程数，以及按工作线程各自缓存累加、随调度变化的stain统计行
+same()
+{
+	local pass_name=$1 input=$2 so=$work/origion.so
+	local filter='s/[0-9.]* ms//g; s/[0-9]* threads//g; /^call frames: \|^taint bytecode: \|^memory ssa: /d'
+	[ "$pass_name" = checker ] && so=$work/checker.so
+	opt -load "$so" -$pass_name $3 -enable-new-pm=0 -disable-output "$input" 2>&1 | sed "$filter" > "$work/out1"
+	opt -load "$so" -$pass_name $4 -enable-new-pm=0 -disable-output "$input" 2>&1 | sed "$filter" > "$work/out2"
+	if cmp -s "$work/out1" "$work/out2"; then
+		pass=$((pass + 1))
+	else
+		fail=$((fail + 1))
+		echo "FAIL: -$pass_name $3 vs $4 $(basename "$input"): outputs differ"
+	fi
+}
+
+# -stain-icall：接口方法调用按itab解析、函数指针按类型解析，解析后两个分支被报告
+check stain "$dir/icall.ll" '^indirect calls: 2 targets over 0 cast, 1 itab, 1 type, 0 unresolved' -stain-entry=Invoke -stain-icall
+check stain "$dir/icall.ll" '^Function main.Invoke br attack :2$' -stain-entry=Invoke -stain-icall
+check stain "$dir/icall.ll" '^Function main.Invoke br attack :0$' -stain-entry=Invoke
+
+# shim API按itab下标解码：GetPrivateData的结果流到分支与shim.Success
+check checker "$data/75/75.0.ll" '^ifds: 2 tainted sinks' -checker-ifds
+check checker "$data/75/75.1.ll" '^ifds: 2 tainted sinks' -checker-ifds
+check checker "$data/75/75.0.ll" '^fast: 2 possible sinks' -checker-tier=fast
+check checker "$data/75/75.0.ll" '^ifds: 2 tainted sinks' -checker-tier=tiered
+
+# -checker-entry：以Invoke为入口；名字含main.的函数都作为入口时，报告与线程数无关
+check checker "$data/94/94.0.ll" '^ifds: 22 tainted sinks' -checker-entry=Invoke -checker-ifds
+# 94的Invoke从不同调用点进入相同的被调函数，摘要边被复用
+check checker "$data/94/94.0.ll" ' [1-9][0-9]* summary edges \([1-9][0-9]* reused\)' -checker-entry=Invoke -checker-ifds
+same checker "$data/75/75.0.ll" "-checker-entry=main. -checker-ifds -checker-threads=1" "-checker-entry=main. -checker-ifds -checker-threads=4"
+same checker "$data/94/94.0.ll" "-checker-entry=main. -checker-tier=tiered -checker-threads=1" "-checker-entry=main. -checker-tier=tiered -checker-threads=4"
+check checker "$data/83/83.0.ll" '^------Detection end, entry function main. not found------$' -checker-entry=main.
+
+# -stain-query：Invoke中GetFunctionAndParameters的结果到达分支；与前向分析共用污点源，被污染的br数与br attack相同
+check stain "$data/75/75.0.ll" '^backward queries: 35 sinks, 20 tainted \(20 br\)' -stain-entry=Invoke -stain-query
+check stain "$data/94/94.0.ll" '^backward queries: 36 sinks, 22 tainted \(22 br\)' -stain-entry=Invoke -stain-query
+
+# 污点源与是否带标签无关：带不带-stain-labels，Invoke中被污染的分支数相同
+check stain "$data/75/75.0.ll" '^Function main.simpleChaincode.Invoke br attack :20$' -stain-entry=Invoke
+check stain "$data/75/75.0.ll" '^Function main.simpleChaincode.Invoke br attack :20$' -stain-entry=Invoke -stain-labels
+check stain "$data/94/94.0.ll" '^Function main.VirtualCoffeeShopChaincode.Invoke br attack :22$' -stain-entry=Invoke
+check stain "$data/94/94.0.ll" '^Function main.VirtualCoffeeShopChaincode.Invoke br attack :22$' -stain-entry=Invoke -stain-labels
+
+# -stain-labels：shim取数API带来源标签，标签到达分支；77中不同来源的标签集合合并命中并集缓存
+check stain "$data/75/75.0.ll" '^label input: 20 branches from 1 sites' -stain-entry=Invoke -stain-labels
+check stain "$data/75/75.0.ll" '^label private: 1 branches from 1 sites' -stain-entry=getPrivate -stain-labels
+check stain "$data/77/77.0.ll" 'union cache [1-9][0-9]* hits' -stain-entry=Invoke -stain-labels
+
+# FPL1.1：putPrivate与getPutPrivate调用PutPrivateData而未调用GetTransient
+check checker "$data/75/75.0.ll" 'FPL1.1 detected in function: .main.simpleChaincode.putPrivate$'
+
+# -stain-scc与-stain-mssa同用：MemorySSA由主线程预先求出，报告与线程数无关
+same stain "$data/94/94.0.ll" "-stain-entry=Invoke -stain-scc -stain-mssa -stain-threads=1" "-stain-entry=Invoke -stain-scc -stain-mssa -stain-threads=4"
+same stain "$data/85/85.0.ll" "-stain-entry=Invoke -stain-scc -stain-mssa -stain-threads=1" "-stain-entry=Invoke -stain-scc -stain-mssa -stain-threads=4"
+
+echo "$pass passed, $fail failed"
+[ $fail -eq 0 ]
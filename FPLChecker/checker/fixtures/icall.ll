@@ -0,0 +1,52 @@
+; -stain-icall的样例
+; main.use中的接口方法调用：itab指针来自main.Invoke中存入局部变量的imt..常量，按偏移8解析为main.T.Get
+; 经@fp的间接调用：没有itab来源，按函数类型解析为地址被取用的main.cb
+; 两个调用的返回值都受入口参数%stub影响；不解析时两个分支都不会被报告
+%_type = type { i64 }
+
+@T..d = global %_type zeroinitializer
+@imt..interface_4Get_5..main.T = internal constant { %_type*, i64 (i8*, i64)*, i64 (i8*, i64)* } { %_type* @T..d, i64 (i8*, i64)* @main.T.Get, i64 (i8*, i64)* @main.T.Put }
+@fp = global i64 (i64)* @main.cb
+
+define i64 @main.T.Get(i8* %r, i64 %x) {
+  %v = ptrtoint i8* %r to i64
+  %y = add i64 %v, %x
+  ret i64 %y
+}
+
+define i64 @main.T.Put(i8* %r, i64 %x) {
+  ret i64 0
+}
+
+define i64 @main.cb(i64 %x) {
+  %y = mul i64 %x, 2
+  ret i64 %y
+}
+
+define internal i64 @main.use(i8* %itab, i8* %data, i64 %k) {
+  %f = getelementptr inbounds i8, i8* %itab, i64 8
+  %p = bitcast i8* %f to i64 (i8*, i64)**
+  %m = load i64 (i8*, i64)*, i64 (i8*, i64)** %p
+  %r = call i64 %m(i8* %data, i64 %k)
+  ret i64 %r
+}
+
+define i64 @main.Invoke(i8* %stub, i64 %k) {
+  %iface = alloca { i8*, i8* }
+  %w = getelementptr { i8*, i8* }, { i8*, i8* }* %iface, i32 0, i32 0
+  store i8* bitcast ({ %_type*, i64 (i8*, i64)*, i64 (i8*, i64)* }* @imt..interface_4Get_5..main.T to i8*), i8** %w
+  %it = load i8*, i8** %w
+  %r1 = call i64 @main.use(i8* %it, i8* %stub, i64 %k)
+  %c = load i64 (i64)*, i64 (i64)** @fp
+  %sv = ptrtoint i8* %stub to i64
+  %r2 = call i64 %c(i64 %sv)
+  %c1 = icmp eq i64 %r1, 5
+  br i1 %c1, label %a, label %b
+a:
+  %c2 = icmp eq i64 %r2, 5
+  br i1 %c2, label %x, label %b
+x:
+  ret i64 1
+b:
+  ret i64 0
+}
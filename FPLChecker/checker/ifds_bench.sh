@@ -0,0 +1,31 @@
+#!/bin/bash
+# 在testData上测量checker的IFDS求解：每个模块以入口函数运行-checker-ifds，汇总ifds行
+# 用法: ifds_bench.sh [入口函数名（默认Invoke）] [其他opt参数...]
+#   输出每个模块各入口函数的被污染汇点、事实、路径边、摘要边（其中复用的）与耗时，最后一行为合计
+# 环境变量: CXX 编译器，DATA 测试数据目录
+
+set -u
+entry=${1:-Invoke}
+[ $# -gt 0 ] && shift
+
+dir=$(cd "$(dirname "$0")" && pwd)
+data=${DATA:-$(dirname "$dir")/testData}
+CXX=${CXX:-$(command -v clang++ || echo c++)}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+$CXX -O2 $(llvm-config --cxxflags) -fno-rtti -fPIC -shared "$dir/checker.cpp" -o "$work/checker.so" \
+	$(llvm-config --ldflags) -lpthread || exit 2
+
+printf '%-12s %8s %8s %12s %8s %8s %10s\n' module sinks facts paths summary reused ms
+for f in "$data"/*/*.ll; do
+	name=$(basename "$(dirname "$f")")/$(basename "$f")
+	opt -load "$work/checker.so" -checker -checker-entry="$entry" -checker-ifds "$@" \
+		-enable-new-pm=0 -disable-output "$f" 2>&1 |
+		sed -n 's/^ifds: \([0-9]*\) tainted sinks, \([0-9]*\) facts, \([0-9]*\) path edges, \([0-9]*\) summary edges (\([0-9]*\) reused), \([0-9.]*\) ms.*/\1 \2 \3 \4 \5 \6/p' |
+		while read -r sinks facts paths sum reused ms; do
+			printf '%-12s %8s %8s %12s %8s %8s %10s\n' "$name" "$sinks" "$facts" "$paths" "$sum" "$reused" "$ms"
+		done
+done | tee "$work/rows"
+awk '{s += $2; f += $3; p += $4; e += $5; r += $6; t += $7}
+	END {printf "%-12s %8d %8d %12d %8d %8d %10.2f\n", "total", s, f, p, e, r, t}' "$work/rows"
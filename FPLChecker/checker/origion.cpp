@@ -5,13 +5,18 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/InlineCost.h"
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/BasicAliasAnalysis.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
-#include "llvm/IR/CallSite.h"
 #include "llvm/IR/CallingConv.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
@@ -20,15 +25,34 @@
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Pass.h"
 #include <map>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "shim.h"
 
 using namespace llvm;
-#define MAX_BASICBLOCK (1 << 10) 	// 一个function中最大的basicblock数
-#define MAX_VAL_Fun (1 << 20)	 	// 一个function中最大的指令数
-#define MAX_VAL_GLOBAL (1 << 20) 	// module中最大全局变量数
 #define MAX_SUB_FUN_DEEP (10)		// 最大函数调用深度
+#define ARENA_SLAB_SIZE (1 << 20)	// FrameArena每次向系统申请的最小字节数
 
 #define No_state (1) 	// 未被污染的值变量
 #define G_ROM_N (2)	 	// 未污染指针变量
@@ -36,753 +60,3517 @@ using namespace llvm;
 #define State (4)	 	// 被污染的值变量 
 #define VAL_Not_Found (-1)	// 不存在此变量
 
-char print_flg;
-//记录function的所有信息
-struct funvalst
+// 污点类型按每个槽位2位打包存放：低位表示指针，高位表示被污染
+// No_state=00, G_ROM_N=01, State=10, G_ROM_S=11，格上的合并（G_ROM_N与State合并为G_ROM_S）即按位或
+#define TAINT_SLOTS_PER_WORD (32)
+typedef std::vector<uint64_t> TaintWords;
+
+static inline unsigned Taint_Bits(unsigned char type)
 {
-	void *Function_Basics[MAX_BASICBLOCK];	// 指向funtion中basicblock的指针数组
-	Value *FunInst[MAX_VAL_Fun];			// 指向function中指令的指针数组
-	unsigned char FunInstVal[MAX_VAL_Fun];	// 记录function中指令的污点类型
-	unsigned char RetType;					// ？？？
-	int functionval_num;					// 指令数
-	int functionarg_num;					// 参数个数
-	int functionglo_num;					// 全局变量数
-};
+	return type == G_ROM_N ? 1 : type == State ? 2 : type == G_ROM_S ? 3 : 0;
+}
 
-namespace
-{	// SBOX - The first implementation, without getAnalysisUsage.
-	struct stain : public FunctionPass
+static inline unsigned char Taint_Type(unsigned bits)
+{
+	static const unsigned char types[4] = {No_state, G_ROM_N, State, G_ROM_S};
+	return types[bits & 3];
+}
+
+static inline size_t Taint_Words(size_t slots)
+{
+	return (slots + TAINT_SLOTS_PER_WORD - 1) / TAINT_SLOTS_PER_WORD;
+}
+
+static inline unsigned char Taint_Get(const uint64_t *words, int idx)
+{
+	return Taint_Type(words[idx / TAINT_SLOTS_PER_WORD] >> (idx % TAINT_SLOTS_PER_WORD * 2));
+}
+
+static inline void Taint_Set(uint64_t *words, int idx, unsigned char type)
+{
+	unsigned shift = idx % TAINT_SLOTS_PER_WORD * 2;
+	uint64_t &w = words[idx / TAINT_SLOTS_PER_WORD];
+	w = (w & ~(3ULL << shift)) | ((uint64_t)Taint_Bits(type) << shift);
+}
+
+// 按字合并：dst |= src，返回dst是否变大
+static inline bool Taint_Join(TaintWords &dst, const TaintWords &src)
+{
+	uint64_t grown = 0;
+	for (size_t w = 0; w < dst.size(); w++)
 	{
-		static char ID;
-		funvalst mainst;				   //用于记录主函数指令信息
-		funvalst subfst[MAX_SUB_FUN_DEEP]; //用于记录子函数指令信息
-		int subdeep;					   //子函数调用深度
-		stain() : FunctionPass(ID) {}
+		grown |= src[w] & ~dst[w];
+		dst[w] |= src[w];
+	}
+	return grown != 0;
+}
 
-		//初始化funvalst实例的数据成员
-		void Clean_st(funvalst *fst)
+#define LABEL_SEED (1 << 15)		// 自底向上模式中代表被污染实参自身的标签，套用摘要时替换为实参的标签
+
+// 各来源种类在报告中的名字
+static const char *Label_Names[LABEL_KINDS] = {"input", "rand/time", "map iteration", "external", "private"};
+
+// 来源标签集合的哈希共享表：标签区分到具体的来源调用点，相同的集合只存一份，槽位中只存32位的集合编号
+// 并集按(编号, 编号)缓存，重复的合并只需一次查表；自底向上模式下各工作线程共用一张表，多于一个线程时由互斥锁保护
+typedef unsigned LabelSet;
+#define LABEL_SET_EMPTY (0)
+
+struct LabelSets
+{
+	std::vector<std::pair<TaintLabels, Instruction *>> Elems;	// 元素：来源种类及来源调用点（入口参数、LABEL_SEED为NULL）
+	DenseMap<std::pair<unsigned, Instruction *>, LabelSet> Singles;	// 元素 → 只含该元素的集合
+	std::vector<std::vector<unsigned>> Sets;	// 集合 → 升序排列的元素
+	std::vector<TaintLabels> Kinds;				// 集合中各元素来源种类的并
+	std::unordered_multimap<size_t, LabelSet> Buckets;	// 元素序列的哈希 → 集合
+	DenseMap<std::pair<LabelSet, LabelSet>, LabelSet> Unions;	// (a, b)，a < b → a ∪ b
+	DenseMap<std::pair<LabelSet, unsigned>, LabelSet> Strips;	// (a, 种类) → a去掉这些种类的元素
+	unsigned long UnionHits, UnionMisses;	// 不含空集与相同集合的并
+	bool Shared;							// 多个工作线程正在共用此表，各操作需加锁
+	std::mutex Lock;
+
+	LabelSets() : UnionHits(0), UnionMisses(0), Shared(false)
+	{
+		Sets.emplace_back();
+		Kinds.push_back(0);
+	}
+
+	// 单线程使用时不加锁
+	std::unique_lock<std::mutex> Guard()
+	{
+		return Shared ? std::unique_lock<std::mutex>(Lock) : std::unique_lock<std::mutex>();
+	}
+
+	// 返回与elems相同的集合，没有则新建
+	LabelSet Intern(std::vector<unsigned> &elems)
+	{
+		size_t h = hash_combine_range(elems.begin(), elems.end());
+		auto range = Buckets.equal_range(h);
+		for (auto it = range.first; it != range.second; ++it)
+			if (Sets[it->second] == elems)
+				return it->second;
+		LabelSet id = Sets.size();
+		TaintLabels kinds = 0;
+		for (unsigned e : elems)
+			kinds |= Elems[e].first;
+		Sets.push_back(std::move(elems));
+		Kinds.push_back(kinds);
+		Buckets.insert({h, id});
+		return id;
+	}
+
+	// 来源调用点site上种类为kind的标签
+	LabelSet Site(TaintLabels kind, Instruction *site)
+	{
+		auto guard = Guard();
+		auto ins = Singles.try_emplace({kind, site}, 0);
+		if (ins.second)
 		{
-			fst->functionval_num = 0;
-			fst->functionarg_num = 0;
-			fst->functionglo_num = 0;
-			for (unsigned int i = 0; i < MAX_VAL_Fun; i++)
-				fst->FunInst[i] = NULL;
-			for (unsigned int i = 0; i < MAX_VAL_Fun; i++)
-				fst->FunInstVal[i] = No_state;
-			fst->RetType = No_state;
+			std::vector<unsigned> elems(1, Elems.size());
+			Elems.push_back({kind, site});
+			ins.first->second = Intern(elems);
 		}
+		return ins.first->second;
+	}
 
-		void Stain_Set(Function *F, funvalst *fst)
+	LabelSet Union(LabelSet a, LabelSet b)
+	{
+		if (a == b || b == LABEL_SET_EMPTY)
+			return a;
+		if (a == LABEL_SET_EMPTY)
+			return b;
+		if (a > b)
+			std::swap(a, b);
+		auto guard = Guard();
+		auto it = Unions.find({a, b});
+		if (it != Unions.end())
 		{
-			Argument *arg;
+			UnionHits++;
+			return it->second;
+		}
+		UnionMisses++;
+		std::vector<unsigned> elems;
+		std::set_union(Sets[a].begin(), Sets[a].end(), Sets[b].begin(), Sets[b].end(), std::back_inserter(elems));
+		LabelSet u = Intern(elems);
+		Unions[{a, b}] = u;
+		return u;
+	}
 
-			for (Function::arg_iterator i = F->arg_begin(), e = F->arg_end(); i != e; ++i)
-			{
-				arg = &*i;
-				fst->FunInst[fst->functionval_num] = arg;
-				//if(i->getType()->getTypeID() != Type::PointerTyID)fst->FunInstVal[fst->functionval_num] = State;
-				//else fst->FunInstVal[fst->functionval_num] = State;//which don't know the data struct
-				if (print_flg)
-					errs() << "arg: %" << fst->functionval_num << "\n";
-				fst->functionval_num++;
-			}
-			fst->FunInstVal[0] = G_ROM_S;
-			fst->functionarg_num = fst->functionval_num;
-			if (print_flg)
-				errs() << "------------------------------------------\n";
+	// a中去掉来源种类属于kinds的元素
+	LabelSet Strip(LabelSet a, TaintLabels kinds)
+	{
+		auto guard = Guard();
+		if (!(Kinds[a] & kinds))
+			return a;
+		auto ins = Strips.try_emplace({a, kinds}, 0);
+		if (ins.second)
+		{
+			std::vector<unsigned> elems;
+			for (unsigned e : Sets[a])
+				if (!(Elems[e].first & kinds))
+					elems.push_back(e);
+			ins.first->second = Intern(elems);
 		}
+		return ins.first->second;
+	}
 
-		// 判断g是否为全局变量，也有可能是常量
-		// 初始化结构中每个元素具有相同的位宽
-		bool IS_ROM(GlobalVariable *g)
+	TaintLabels Kind(LabelSet a)
+	{
+		auto guard = Guard();
+		return Kinds[a];
+	}
+
+	// a中来源种类属于kinds的元素个数
+	unsigned Count(LabelSet a, TaintLabels kinds)
+	{
+		auto guard = Guard();
+		unsigned n = 0;
+		for (unsigned e : Sets[a])
+			n += (Elems[e].first & kinds) != 0;
+		return n;
+	}
+
+	// 共享表中元素序列占用的字节数
+	size_t Bytes()
+	{
+		auto guard = Guard();
+		size_t bytes = 0;
+		for (auto &set : Sets)
+			bytes += sizeof(set) + set.size() * sizeof(unsigned);
+		return bytes;
+	}
+
+	// 若每个槽位各存一份集合（不共享）所需的字节数
+	size_t Unshared_Bytes(const LabelSet *slots, size_t n)
+	{
+		auto guard = Guard();
+		size_t bytes = 0;
+		for (size_t k = 0; k < n; k++)
+			bytes += sizeof(std::vector<unsigned>) + Sets[slots[k]].size() * sizeof(unsigned);
+		return bytes;
+	}
+};
+
+// -stain-entry: 函数名中含有该字符串的函数作为入口函数分析
+static cl::opt<std::string> StainEntry("stain-entry", cl::init("pay"),
+								cl::desc("analyse functions whose name contains this string as entries"));
+
+// -stain-bench: 加载模块时在256到262144个槽位的合成帧上测量Find_Val的平均查找耗时
+static cl::opt<bool> StainBench("stain-bench", cl::init(false),
+								cl::desc("time Find_Val on synthetic frames of growing size"));
+
+// -stain-scc: 按调用图SCC自底向上计算所有函数的摘要，调用点直接套用摘要，不受MAX_SUB_FUN_DEEP限制
+static cl::opt<bool> StainSCC("stain-scc", cl::init(false),
+							  cl::desc("summarise callees bottom-up over call graph SCCs"));
+
+// -stain-threads: 自底向上模式的工作线程数，0表示按硬件线程数
+static cl::opt<unsigned> StainThreads("stain-threads", cl::init(0),
+									  cl::desc("worker threads for -stain-scc (0 = hardware threads)"));
+
+// -stain-labels: 按被调函数名给返回值打上来源标签并随污点传播，报告各标签到达的分支、返回值和全局变量
+static cl::opt<bool> StainLabels("stain-labels", cl::init(false),
+								 cl::desc("propagate per-source taint labels and report sinks per label"));
+
+// -stain-mssa: 只经load/store直接访问的alloca，其内存流按MemorySSA由到达的store连到load，不再翻转指针槽位
+static cl::opt<bool> StainMSSA("stain-mssa", cl::init(false),
+							   cl::desc("resolve store/load flow of non-escaping allocas through MemorySSA"));
+
+// -stain-implicit: 隐式流，分支条件被污染时，控制依赖于该分支的指令结果与store目标也被污染
+static cl::opt<bool> StainImplicit("stain-implicit", cl::init(false),
+								   cl::desc("propagate taint along control dependences of tainted branches"));
+
+// -stain-slice: 降低后只保留污点源前向切片与汇点反向切片之交上的传递函数，其余槽位不再参与不动点
+static cl::opt<bool> StainSlice("stain-slice", cl::init(false),
+								cl::desc("propagate only over the forward slice of the sources intersected with the backward slice of the sinks"));
+
+// -stain-budget-*: 单个函数一次分析的预算，耗尽时该函数的结果放宽为全部污染后继续分析；0表示不限
+static cl::opt<unsigned> StainBudgetEvals("stain-budget-evals", cl::init(0),
+										  cl::desc("transfer evaluations allowed per function analysis (0 = unlimited)"));
+static cl::opt<unsigned> StainBudgetMs("stain-budget-ms", cl::init(0),
+									   cl::desc("wall time in ms allowed per function analysis (0 = unlimited)"));
+static cl::opt<unsigned> StainBudgetKB("stain-budget-kb", cl::init(0),
+									   cl::desc("frame memory in KB allowed along the call chain (0 = unlimited)"));
+
+// -stain-module-budget-*: 整个模块的预算，耗尽后其余函数不再迭代而直接放宽
+static cl::opt<unsigned> StainModuleBudgetEvals("stain-module-budget-evals", cl::init(0),
+												cl::desc("transfer evaluations allowed per module (0 = unlimited)"));
+static cl::opt<unsigned> StainModuleBudgetMs("stain-module-budget-ms", cl::init(0),
+											 cl::desc("wall time in ms allowed per module (0 = unlimited)"));
+
+// -stain-icall: 间接调用按gollvm的itab解出具体方法，解不出时按函数类型取候选被调函数
+static cl::opt<bool> StainICall("stain-icall", cl::init(false),
+								cl::desc("resolve indirect calls through gollvm itabs, falling back to function-type buckets"));
+
+// -stain-query: 不做前向传播，从入口函数的汇点出发按需反向查询能否到达污点源
+static cl::opt<bool> StainQuery("stain-query", cl::init(false),
+								cl::desc("answer backward taint queries from the entry's sinks instead of propagating forward"));
+
+#define QUERY_TAINTED (1)	// 可到达污点源
+#define QUERY_CLEAN (2)		// 反向切片中没有污点源
+
+// 从汇点出发的按需反向污点查询，只访问汇点的反向切片
+// 反向边：指令 → 操作数；指针 → 其底层对象的写入者；调用结果 → 被调函数的返回值；形参 → 各调用点的实参。
+//         写入者为store、memcpy/memset，以及经由sret参数（标签来源另含其输出参数）写入的无定义函数；
+//         有定义的被调函数按其中经由对应形参的写入者计。与前向分析一样，不是污点源的无定义函数和
+//         未解析的间接调用不传递污点（-stain-icall不影响查询）
+// 污点源与前向分析相同：入口函数的第0个参数（Stain_Set），以及ShimTable::Source判定的调用点
+// 结果按值缓存：查询到达污点源时路径上的值都被污染，切片耗尽时切片中的值都未被污染
+struct TaintQuery
+{
+	Function *Entry;
+	const ShimTable *Shim;								// 模块的shim API调用点，取数API的结果为污点源
+	DenseMap<Value *, unsigned char> Memo;
+	DenseMap<Value *, std::vector<Value *>> Writers;	// 内存对象 → 写入者
+	DenseMap<Function *, std::vector<Value *>> Rets;	// 函数 → 各ret的返回值
+	unsigned long Visited;								// 各查询展开的值个数之和
+
+	TaintQuery(Function *F, const ShimTable *shim) : Entry(F), Shim(shim), Visited(0) {}
+
+	// 污点源：入口函数的第0个参数，以及按名字匹配的函数与shim取数API的调用
+	bool Is_Source(Value *v)
+	{
+		unsigned char out;
+		if (Argument *A = dyn_cast<Argument>(v))
+			return A->getParent() == Entry && A->getArgNo() == 0;
+		if (CallBase *CB = dyn_cast<CallBase>(v))
+			return Shim->Source(CB, CB->getCalledFunction(), out) != 0;
+		return false;
+	}
+
+	// 只有指令、参数、全局变量和常量表达式可能被污染
+	static void Push(SmallVectorImpl<Value *> &out, Value *v)
+	{
+		if (isa<Instruction>(v) || isa<Argument>(v) || isa<GlobalVariable>(v) || isa<ConstantExpr>(v))
+			out.push_back(v);
+	}
+
+	// 无定义的被调函数是否经由第j个实参写入内存
+	bool Call_Writes(CallBase *CB, Function *callee, unsigned j)
+	{
+		unsigned char out;
+		if (CB->paramHasAttr(j, Attribute::StructRet))
+			return true;
+		return Shim->Source(CB, callee, out) && out == LABEL_OUT_LAST && j + 1 == CB->arg_size();
+	}
+
+	// 写入o所指内存（及经由o取出的指针所指内存）的写入者；递归调用链上正在计算的对象按无写入者处理
+	std::vector<Value *> &Find_Writers(Value *o)
+	{
+		auto it = Writers.find(o);
+		if (it != Writers.end())
+			return it->second;
+		Writers[o];
+		std::vector<Value *> found;
+		SmallVector<Value *, 8> stack;
+		SmallPtrSet<Value *, 16> seen;
+		stack.push_back(o);
+		seen.insert(o);
+		while (!stack.empty())
 		{
-			int l = 0;
-			unsigned int witwidth;
-			Constant *CT;
-			// Constant *getInitializer(): Returns the initial value for a GlobalVariable
-			if (CT = g->getInitializer()->getAggregateElement(l))
-				l++;
-			else
-				return 0;
-			if (dyn_cast<ConstantInt>(CT))
-				witwidth = dyn_cast<ConstantInt>(CT)->getBitWidth();
-			else
-				return 0;
-			l++;
-			while (CT = g->getInitializer()->getAggregateElement(l))
+			Value *p = stack.pop_back_val();
+			for (User *u : p->users())
 			{
-				if (dyn_cast<ConstantInt>(CT))
+				if (StoreInst *SI = dyn_cast<StoreInst>(u))
 				{
-					if (witwidth != dyn_cast<ConstantInt>(CT)->getBitWidth())
-						return 0;
+					if (SI->getPointerOperand() == p)
+						found.push_back(SI);
+				}
+				else if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(u))
+				{
+					if (MI->getRawDest() == p)
+						found.push_back(MI);
+				}
+				else if (CallBase *CB = dyn_cast<CallBase>(u))
+				{
+					Function *callee = CB->getCalledFunction();
+					if (isa<IntrinsicInst>(CB))
+						continue;
+					for (unsigned j = 0; j < CB->arg_size(); j++)
+					{
+						if (CB->getArgOperand(j) != p)
+							continue;
+						if (callee && !callee->isDeclaration() && j < callee->arg_size())
+						{
+							std::vector<Value *> &inner = Find_Writers(callee->getArg(j));
+							found.insert(found.end(), inner.begin(), inner.end());
+						}
+						else if (Call_Writes(CB, callee, j))
+							found.push_back(CB);
+					}
+				}
+				else if (isa<GetElementPtrInst>(u) || isa<CastInst>(u) || isa<PHINode>(u) || isa<SelectInst>(u) ||
+						 isa<ConstantExpr>(u) || (isa<LoadInst>(u) && u->getType()->isPointerTy()))
+				{
+					if (seen.insert(u).second)
+						stack.push_back(u);
 				}
-				else
-					return 0;
-				l++;
 			}
-			return 1;
 		}
+		return Writers[o] = std::move(found);
+	}
 
-		//获取module中所有全局变量并对被污染情况进行初始化
-		void Find_All_GloabalVariable(Module *M, funvalst *fst)
+	std::vector<Value *> &Find_Rets(Function *F)
+	{
+		auto it = Rets.find(F);
+		if (it != Rets.end())
+			return it->second;
+		std::vector<Value *> found;
+		for (BasicBlock &B : *F)
+			if (ReturnInst *RI = dyn_cast<ReturnInst>(B.getTerminator()))
+				if (RI->getReturnValue())
+					found.push_back(RI->getReturnValue());
+		return Rets[F] = std::move(found);
+	}
+
+	// v的反向边
+	void Preds(Value *v, SmallVectorImpl<Value *> &out)
+	{
+		if (Argument *A = dyn_cast<Argument>(v))
 		{
-			int l = 0;
-			for (Module::global_iterator i = M->global_begin(), e = M->global_end(); i != e; ++i)
+			if (A->getParent() != Entry)
+				for (User *u : A->getParent()->users())
+					if (CallBase *CB = dyn_cast<CallBase>(u))
+						if (CB->getCalledOperand() == A->getParent() && A->getArgNo() < CB->arg_size())
+							Push(out, CB->getArgOperand(A->getArgNo()));
+		}
+		else if (MemTransferInst *MT = dyn_cast<MemTransferInst>(v))
+			Push(out, MT->getRawSource());
+		else if (MemSetInst *MS = dyn_cast<MemSetInst>(v))
+			Push(out, MS->getValue());
+		else if (CallBase *CB = dyn_cast<CallBase>(v))
+		{
+			Function *callee = CB->getCalledFunction();
+			if (callee && !callee->isDeclaration())
+				for (Value *r : Find_Rets(callee))
+					Push(out, r);
+		}
+		else if (LoadInst *LI = dyn_cast<LoadInst>(v))
+			Push(out, LI->getPointerOperand());
+		else if (StoreInst *SI = dyn_cast<StoreInst>(v))
+			Push(out, SI->getValueOperand());
+		else if (isa<Instruction>(v) || isa<ConstantExpr>(v))
+		{
+			for (Value *op : cast<User>(v)->operands())
+				Push(out, op);
+		}
+		// 指针还依赖其所指内存中写入的值
+		if (v->getType()->isPointerTy())
+		{
+			Value *o = getUnderlyingObject(v);
+			if (!isa<Constant>(o) || isa<GlobalVariable>(o))
+				for (Value *w : Find_Writers(o))
+					out.push_back(w);
+		}
+	}
+
+	// 汇点值sink能否反向到达污点源，广度优先展开，到达污点源即停止
+	unsigned char Query(Value *sink)
+	{
+		auto m = Memo.find(sink);
+		if (m != Memo.end())
+			return m->second;
+		DenseMap<Value *, Value *> parent;
+		std::vector<Value *> work;
+		Value *hit = NULL;
+		parent[sink] = NULL;
+		work.push_back(sink);
+		for (size_t k = 0; k < work.size() && !hit; k++)
+		{
+			Value *v = work[k];
+			Visited++;
+			auto mm = Memo.find(v);
+			if (mm != Memo.end() && mm->second == QUERY_CLEAN)
+				continue;
+			if ((mm != Memo.end() && mm->second == QUERY_TAINTED) || Is_Source(v))
 			{
-				// 将全局变量顺序加入FunInst数组
-				errs() << fst->functionval_num;
-				fst->FunInst[fst->functionval_num] = &*i;
-				l = 0;
-				if (print_flg)
-					errs() << i->getName() << " ";
-				while (i->getInitializer()->getAggregateElement(l))
-					l++;
-				if (l == 0)
-					l = 1; //have only single value;
-				errs() << "1";
-				// 若该全局变量是变量类型，则标记为G_ROM_N
-				if (IS_ROM(&*i))
-				{
-					errs() << "2";
-					Constant *CT = i->getInitializer()->getAggregateElement(l - 1);
-					fst->FunInstVal[fst->functionval_num] = G_ROM_N;
-					if (print_flg && dyn_cast<ConstantInt>(CT))
-						errs() << " " << dyn_cast<ConstantInt>(CT)->getBitWidth() / 8 << "Byte X "
-							   << "[" << l << "] G_ROM\n";
-				}
-				// 若该全局变量不是变量类型（常量），则标记为No_state
-				else
-				{
-					errs() << "3";
-					fst->FunInstVal[fst->functionval_num] = No_state;
-					if (print_flg && dyn_cast<ConstantInt>(i->getInitializer()))
-						errs() << dyn_cast<ConstantInt>(i->getInitializer())->getBitWidth() / 8 << "Byte X "
-							   << "[" << l << "] State\n";
-				}
-				errs() << "4";
-				fst->functionval_num++;
+				hit = v;
+				break;
 			}
-			fst->functionglo_num = fst->functionval_num - fst->functionarg_num;
-			if (print_flg)
-				errs() << "------------------------------------------\n";
+			SmallVector<Value *, 8> preds;
+			Preds(v, preds);
+			for (Value *p : preds)
+				if (parent.try_emplace(p, v).second)
+					work.push_back(p);
 		}
+		if (hit)
+			for (Value *v = hit; v; v = parent[v])
+				Memo[v] = QUERY_TAINTED;
+		else
+			for (Value *v : work)
+				Memo[v] = QUERY_CLEAN;
+		return hit ? QUERY_TAINTED : QUERY_CLEAN;
+	}
+};
 
-		// 遍历basicblock中指令并初始化其污点类型
-		// 除了store等（user为0的）的指令
-		void Serch_Blocks(BasicBlock *BB_c, funvalst *fst)
+#define ICALL_CAST (0)	// 被调操作数是函数的类型转换
+#define ICALL_ITAB (1)	// itab指针的来源都是itab常量，取其中对应偏移处的方法
+#define ICALL_TYPE (2)	// 取函数类型相同且地址被取用的函数
+#define ICALL_NONE (3)	// 没有候选
+#define ICALL_KINDS (4)
+
+static const char *ICall_Names[ICALL_KINDS] = {"cast", "itab", "type", "unresolved"};
+
+// 间接调用点的候选被调函数（-stain-icall）
+// gollvm的接口值为(itab, 数据指针)两个字。itab即imt..（值接收者）/pimt..（指针接收者）常量：
+// 第0项指向具体类型的类型描述符，其后为各方法，接口方法调用从itab按常量偏移取出函数指针再调用。
+// 依次尝试：沿itab指针的来源（类型转换、phi/select、insertvalue、局部变量中写入的值、内部函数形参对应的各调用点实参）
+// 找全itab常量时取其中该偏移处的方法；否则取函数类型相同、地址被取用的函数。
+// 来源不明的itab不按偏移在模块的所有itab中匹配：不同接口同一偏移处的方法互不相关。
+// 候选集合在Build时对模块中每个间接调用点求一次，分析期间只读，各工作线程共用
+struct CallResolver
+{
+	const DataLayout *DL;
+	DenseMap<GlobalVariable *, DenseMap<uint64_t, Function *>> Itabs;	// itab常量 → 偏移 → 方法
+	DenseMap<FunctionType *, std::vector<Function *>> Buckets;	// 函数类型 → 地址被取用的函数
+	DenseMap<Instruction *, std::vector<Function *>> Sites;	// 间接调用点 → 候选被调函数
+	unsigned long Kinds[ICALL_KINDS];	// 各方式解析的调用点数
+	unsigned long Targets;				// 候选总数
+	size_t MaxTargets;					// 单个调用点的最大候选数
+
+	CallResolver() : DL(NULL) {}
+
+	ArrayRef<Function *> Find_Targets(Instruction *I) const
+	{
+		auto it = Sites.find(I);
+		if (it == Sites.end())
+			return ArrayRef<Function *>();
+		return it->second;
+	}
+
+	// itab常量：名字为imt../pimt..，初值第0项指向类型描述符，其余各项为方法
+	void Decode_Itab(GlobalVariable &g)
+	{
+		if (!g.getName().startswith("imt..") && !g.getName().startswith("pimt.."))
+			return;
+		if (!g.hasDefinitiveInitializer())
+			return;
+		ConstantStruct *CS = dyn_cast<ConstantStruct>(g.getInitializer());
+		if (!CS || CS->getNumOperands() < 2 || !isa<GlobalVariable>(CS->getOperand(0)->stripPointerCasts()))
+			return;
+		const StructLayout *SL = DL->getStructLayout(CS->getType());
+		DenseMap<uint64_t, Function *> &methods = Itabs[&g];
+		for (unsigned j = 1; j < CS->getNumOperands(); j++)
+			if (Function *f = dyn_cast<Function>(CS->getOperand(j)->stripPointerCasts()))
+				methods[SL->getElementOffset(j)] = f;
+	}
+
+	// f能否作为CB的被调函数：参数个数与返回类型相同，参数类型相同或同为指针（方法的接收者在itab中为具体类型的指针）
+	static bool Compatible(Function *f, CallBase *CB)
+	{
+		if (f->arg_size() != CB->arg_size() || f->getReturnType() != CB->getType())
+			return false;
+		for (unsigned j = 0; j < CB->arg_size(); j++)
 		{
-			Instruction *Inst;
-			int i;
-			for (BasicBlock::iterator i2 = BB_c->begin(), e2 = BB_c->end(); i2 != e2; ++i2)
+			Type *a = f->getArg(j)->getType(), *b = CB->getArgOperand(j)->getType();
+			if (a != b && !(a->isPointerTy() && b->isPointerTy()))
+				return false;
+		}
+		return true;
+	}
+
+	// 局部变量o中偏移off处写入过的值；o的地址逃逸或以非常量偏移访问时返回false
+	bool Stored_Values(AllocaInst *o, int64_t off, SmallVectorImpl<Value *> &vals)
+	{
+		unsigned bits = DL->getIndexTypeSizeInBits(o->getType());
+		SmallVector<std::pair<Value *, int64_t>, 8> stack;
+		SmallPtrSet<Value *, 16> seen;
+		stack.push_back({o, 0});
+		seen.insert(o);
+		while (!stack.empty())
+		{
+			Value *p = stack.back().first;
+			int64_t at = stack.back().second;
+			stack.pop_back();
+			for (User *u : p->users())
 			{
-				Inst = &*i2;
-				// store和br指令并没有value实例，will not be used
-				// 推测Inst这里指的就是指令的执行结果或者返回值
-				if (Inst->hasNUsesOrMore(1))
-				{                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                     
-					if (Inst->getOpcode() == Instruction::Alloca)
-					{
-						fst->FunInst[fst->functionval_num] = Inst;
-						fst->FunInstVal[fst->functionval_num] = G_ROM_N;
-						fst->functionval_num++;
-					}
-					else
-					{
-						fst->FunInst[fst->functionval_num] = Inst;
-						if (Inst->getType()->isPointerTy())
-							fst->FunInstVal[fst->functionval_num] = G_ROM_N;
-						else
-							fst->FunInstVal[fst->functionval_num] = No_state;
-						fst->functionval_num++;
-					}
+				if (StoreInst *SI = dyn_cast<StoreInst>(u))
+				{
+					if (SI->getValueOperand() == p)
+						return false;
+					if (at == off)
+						vals.push_back(SI->getValueOperand());
 				}
-				else if (Inst->getOpcode() == Instruction::Ret)
+				else if (isa<LoadInst>(u) || isa<DbgInfoIntrinsic>(u) ||
+						 (isa<IntrinsicInst>(u) && cast<IntrinsicInst>(u)->isLifetimeStartOrEnd()))
+					continue;
+				else if (GEPOperator *GEP = dyn_cast<GEPOperator>(u))
 				{
-					// 如果返回值非空
-					if (Inst->getNumOperands())
-					{
-						fst->FunInst[fst->functionval_num] = Inst;
-						if (Inst->getOperand(0)->getType()->isPointerTy())
-							fst->FunInstVal[fst->functionval_num] = G_ROM_N;
-						else
-							fst->FunInstVal[fst->functionval_num] = No_state;
-						fst->functionval_num++;
-					}
-					else
-					{
-						fst->FunInst[fst->functionval_num] = Inst;
-						fst->FunInstVal[fst->functionval_num] = No_state;
-						fst->functionval_num++;
-					}
+					APInt delta(bits, 0);
+					if (!GEP->accumulateConstantOffset(*DL, delta))
+						return false;
+					if (seen.insert(u).second)
+						stack.push_back({u, at + delta.getSExtValue()});
+				}
+				else if (isa<BitCastOperator>(u))
+				{
+					if (seen.insert(u).second)
+						stack.push_back({u, at});
 				}
+				else
+					return false;
 			}
 		}
+		return true;
+	}
 
-		// 遍历function中的所有basicblock，调用Serch_Blocks初始化其污点类型
-		void Find_All_FunctionVal(Function *F, funvalst *fst)
+	// itab指针v可能来自的itab常量；有来源无法确定时返回false
+	bool Itab_Origins(Value *v, SmallPtrSetImpl<Value *> &seen, SmallVectorImpl<GlobalVariable *> &out)
+	{
+		v = v->stripPointerCasts();
+		if (!seen.insert(v).second)
+			return true;
+		if (GlobalVariable *g = dyn_cast<GlobalVariable>(v))
 		{
-			BasicBlock *BB_c;
-			for (Function::iterator i = F->begin(), e = F->end(); i != e; ++i)
+			if (!Itabs.count(g))
+				return false;
+			out.push_back(g);
+			return true;
+		}
+		if (PHINode *PN = dyn_cast<PHINode>(v))
+		{
+			for (Value *in : PN->incoming_values())
+				if (!Itab_Origins(in, seen, out))
+					return false;
+			return true;
+		}
+		if (SelectInst *SI = dyn_cast<SelectInst>(v))
+			return Itab_Origins(SI->getTrueValue(), seen, out) && Itab_Origins(SI->getFalseValue(), seen, out);
+		if (ExtractValueInst *EV = dyn_cast<ExtractValueInst>(v))
+			return Field_Origins(EV->getAggregateOperand(), EV->getIndices(), seen, out);
+		if (LoadInst *LI = dyn_cast<LoadInst>(v))
+		{
+			APInt off(DL->getIndexTypeSizeInBits(LI->getPointerOperandType()), 0);
+			AllocaInst *o = dyn_cast<AllocaInst>(LI->getPointerOperand()->stripAndAccumulateConstantOffsets(*DL, off, true));
+			SmallVector<Value *, 4> vals;
+			if (!o || !Stored_Values(o, off.getSExtValue(), vals) || vals.empty())
+				return false;
+			for (Value *val : vals)
+				if (!Itab_Origins(val, seen, out))
+					return false;
+			return true;
+		}
+		// 内部函数的形参只来自模块中的直接调用点
+		if (Argument *A = dyn_cast<Argument>(v))
+		{
+			Function *f = A->getParent();
+			if (!f->hasLocalLinkage() || f->use_empty())
+				return false;
+			for (User *u : f->users())
 			{
-				BB_c = &*i;
-				Serch_Blocks(BB_c, fst);
+				CallBase *CB = dyn_cast<CallBase>(u);
+				if (!CB || CB->getCalledOperand() != f || A->getArgNo() >= CB->arg_size())
+					return false;
+				if (!Itab_Origins(CB->getArgOperand(A->getArgNo()), seen, out))
+					return false;
 			}
+			return true;
 		}
+		return false;
+	}
 
-		// 返回所有使用v的指令
-		Value *Find_Used_Inst(Value *v)
+	// 聚合值agg中下标为idx的字段（接口值的itab字）可能来自的itab常量
+	// 接口值由insertvalue拼成，或作为有定义函数的返回值传出
+	bool Field_Origins(Value *agg, ArrayRef<unsigned> idx, SmallPtrSetImpl<Value *> &seen, SmallVectorImpl<GlobalVariable *> &out)
+	{
+		if (!seen.insert(agg).second)
+			return true;
+		if (InsertValueInst *IV = dyn_cast<InsertValueInst>(agg))
 		{
-			for (User *u : v->users())
+			if (IV->getIndices() == idx)
+				return Itab_Origins(IV->getInsertedValueOperand(), seen, out);
+			return Field_Origins(IV->getAggregateOperand(), idx, seen, out);
+		}
+		if (Constant *C = dyn_cast<Constant>(agg))
+		{
+			for (unsigned i : idx)
+				if (!C || !(C = C->getAggregateElement(i)))
+					return false;
+			return Itab_Origins(C, seen, out);
+		}
+		if (PHINode *PN = dyn_cast<PHINode>(agg))
+		{
+			for (Value *in : PN->incoming_values())
+				if (!Field_Origins(in, idx, seen, out))
+					return false;
+			return true;
+		}
+		if (CallBase *CB = dyn_cast<CallBase>(agg))
+		{
+			Function *callee = CB->getCalledFunction();
+			if (!callee || callee->isDeclaration())
+				return false;
+			for (BasicBlock &B : *callee)
+				if (ReturnInst *RI = dyn_cast<ReturnInst>(B.getTerminator()))
+					if (!RI->getReturnValue() || !Field_Origins(RI->getReturnValue(), idx, seen, out))
+						return false;
+			return true;
+		}
+		return false;
+	}
+
+	// 求间接调用点CB的候选被调函数，返回解析方式（ICALL_*）
+	unsigned Resolve(CallBase *CB, std::vector<Function *> &targets)
+	{
+		Value *callee = CB->getCalledOperand()->stripPointerCasts();
+		SmallPtrSet<Function *, 8> added;
+		auto add = [&](Function *f) {
+			if (Compatible(f, CB) && added.insert(f).second)
+				targets.push_back(f);
+		};
+		if (Function *f = dyn_cast<Function>(callee))
+		{
+			add(f);
+			return targets.empty() ? ICALL_NONE : ICALL_CAST;
+		}
+		// 接口方法调用：函数指针从itab的常量偏移处取出
+		if (LoadInst *LI = dyn_cast<LoadInst>(callee))
+		{
+			APInt off(DL->getIndexTypeSizeInBits(LI->getPointerOperandType()), 0);
+			Value *itab = LI->getPointerOperand()->stripAndAccumulateConstantOffsets(*DL, off, true);
+			SmallPtrSet<Value *, 16> seen;
+			SmallVector<GlobalVariable *, 4> origins;
+			if (off.isStrictlyPositive() && Itab_Origins(itab, seen, origins))
 			{
-				if (dyn_cast<Instruction>(u))
-					return u;
-				// ConstantExpr: 由使用v初始化的常量值。
-				// https://lists.llvm.org/pipermail/llvm-dev/2013-April/060949.html
-				else if (dyn_cast<ConstantExpr>(u))
-					Find_Used_Inst(u);
+				for (GlobalVariable *g : origins)
+					if (Function *f = Itabs[g].lookup(off.getZExtValue()))
+						add(f);
+				if (!targets.empty())
+					return ICALL_ITAB;
 			}
-			return NULL;
 		}
+		auto bucket = Buckets.find(CB->getFunctionType());
+		if (bucket != Buckets.end())
+			for (Function *f : bucket->second)
+				add(f);
+		return targets.empty() ? ICALL_NONE : ICALL_TYPE;
+	}
 
-		// 确保v（如果是常量表达式则继续追溯def-use）是Instruction类型
-		Value *Used_to_Inst(Value *v)
+	// 解码M中的itab，按函数类型索引地址被取用的函数，再解析每个间接调用点
+	void Build(Module &M)
+	{
+		DL = &M.getDataLayout();
+		Itabs.clear();
+		Buckets.clear();
+		Sites.clear();
+		std::fill(Kinds, Kinds + ICALL_KINDS, 0);
+		Targets = MaxTargets = 0;
+		for (GlobalVariable &g : M.globals())
+			Decode_Itab(g);
+		for (Function &F : M)
+			if (!F.isDeclaration() && F.hasAddressTaken())
+				Buckets[F.getFunctionType()].push_back(&F);
+		for (Function &F : M)
+			for (Instruction &I : instructions(F))
+			{
+				CallBase *CB = dyn_cast<CallBase>(&I);
+				if (!CB || I.getOpcode() != llvm::Instruction::Call || CB->isInlineAsm() ||
+					isa<Function>(I.getOperand(I.getNumOperands() - 1)))
+					continue;
+				std::vector<Function *> targets;
+				Kinds[Resolve(CB, targets)]++;
+				Targets += targets.size();
+				MaxTargets = std::max(MaxTargets, targets.size());
+				if (!targets.empty())
+					Sites[&I] = std::move(targets);
+			}
+	}
+};
+
+// 分析帧数组的bump分配区
+// 帧按调用深度后进先出地分配，回退到某一位置时既不清零也不归还内存，供下一个调用点复用
+struct FrameArena
+{
+	struct Mark
+	{
+		size_t Cur;	// 内存块序号
+		size_t Off;	// 块内偏移
+	};
+	std::vector<std::pair<char *, size_t>> Slabs;	// 已申请的内存块及其大小
+	size_t Cur = 0;
+	size_t Off = 0;
+
+	~FrameArena()
+	{
+		for (auto &slab : Slabs)
+			free(slab.first);
+	}
+
+	Mark Save() const { return {Cur, Off}; }
+	void Release(Mark m)
+	{
+		Cur = m.Cur;
+		Off = m.Off;
+	}
+
+	void *Allocate(size_t size, size_t align)
+	{
+		for (;;)
 		{
-			if (dyn_cast<Instruction>(v))
-				return v;
-			if (dyn_cast<ConstantExpr>(v))
+			if (Cur == Slabs.size())
 			{
-				for (User *u : v->users())
-				{
-					if (dyn_cast<Instruction>(u))
-						return u;
+				size_t bytes = std::max<size_t>(ARENA_SLAB_SIZE, size + align);
+				Slabs.emplace_back((char *)safe_malloc(bytes), bytes);
+				Off = 0;
+			}
+			size_t p = alignTo(Off, align);
+			if (p + size <= Slabs[Cur].second)
+			{
+				Off = p + size;
+				return Slabs[Cur].first + p;
+			}
+			// 当前块放不下，换到下一块；下一块位于回退点之后，太小时可直接替换
+			Cur++;
+			Off = 0;
+			if (Cur < Slabs.size() && Slabs[Cur].second < size + align)
+			{
+				free(Slabs[Cur].first);
+				size_t bytes = std::max<size_t>(ARENA_SLAB_SIZE, size + align);
+				Slabs[Cur] = {(char *)safe_malloc(bytes), bytes};
+			}
+		}
+	}
+
+	template <typename T> T *Allocate(size_t num)
+	{
+		return (T *)Allocate(num * sizeof(T), alignof(T));
+	}
+
+	// 回退点m之前占用的字节数，即调用链上各帧数组的总大小
+	size_t Used(Mark m) const
+	{
+		size_t bytes = m.Off;
+		for (size_t s = 0; s < m.Cur && s < Slabs.size(); s++)
+			bytes += Slabs[s].second;
+		return bytes;
+	}
+
+	size_t Reserved() const
+	{
+		size_t bytes = 0;
+		for (auto &slab : Slabs)
+			bytes += slab.second;
+		return bytes;
+	}
+};
+
+// 被调函数在某一输入上下文下的分析结果
+struct TaintSummary
+{
+	unsigned char RetType;									 // 返回值污点类型
+	std::vector<unsigned char> ArgType;						 // 分析结束时各参数的污点类型
+	std::vector<std::pair<GlobalVariable *, unsigned char>> GloWrite; // 被改变的全局变量及其结果
+	LabelSet RetLabels;										 // 以下为-stain-labels下对应的来源标签集合
+	std::vector<LabelSet> ArgLabels;
+	std::vector<LabelSet> GloLabels;						 // 与GloWrite一一对应
+
+	TaintSummary() : RetLabels(LABEL_SET_EMPTY) {}
+};
+
+// 自底向上模式中函数的上下文无关摘要
+// 下标0为所有实参均未污染时的结果，下标j+1为仅第j个实参被污染时的结果
+struct SccSummary
+{
+	std::vector<unsigned char> RetType;				 // 返回值污点类型
+	std::vector<std::vector<unsigned char>> ArgType; // 分析结束时各参数的污点类型
+	std::vector<LabelSet> RetLabels;				 // 对应的来源标签集合，LABEL_SEED表示被污染实参的标签
+	std::vector<std::vector<LabelSet>> ArgLabels;
+};
+
+// 函数中可解析alloca上的各load（按指令顺序）及其到达的store，只依赖IR
+typedef std::vector<std::pair<LoadInst *, SmallVector<StoreInst *, 2>>> MemFlow;
+
+// 自底向上模式的模块级共享状态
+struct SccState
+{
+	DenseMap<Function *, SccSummary> Summary; // 所有已定义函数的摘要，并行分析前预先建好表项
+	TaintWords GloType;						  // 按模块中顺序排列的全局变量污点类型（2位打包）
+	std::vector<LabelSet> GloLabels;		  // 全局变量的来源标签集合
+	DenseMap<Function *, MemFlow> MemFlows;	  // -stain-mssa时各函数的MemorySSA结果，由主线程在并行分析前求出
+};
+
+#define BUDGET_EVALS (1)	// 单个函数的求值次数
+#define BUDGET_TIME (2)		// 单个函数的分析时间
+#define BUDGET_MEMORY (4)	// 调用链上各帧占用的分配区
+#define BUDGET_MODULE (8)	// 模块的求值次数或分析时间
+#define BUDGET_CHECK (256)	// 两次检查预算之间的求值次数
+
+static const char *Budget_Names[] = {"evals", "time", "memory", "module"};
+
+// 模块级预算，由pass持有，自底向上模式下各工作线程共用
+struct TaintBudget
+{
+	Module *M;									// 预算所属的模块
+	std::chrono::steady_clock::time_point Start;	// 模块开始分析的时间
+	std::atomic<unsigned long> Evals;			// 模块中已做的传递函数求值次数
+	std::atomic<bool> Exhausted;				// 模块预算已耗尽
+	TaintBudget() : M(NULL), Evals(0), Exhausted(false) {}
+};
+
+// 函数耗尽预算被放宽的次数与原因（BUDGET_*按位或）
+struct BudgetHit
+{
+	unsigned Count;
+	unsigned Reasons;
+};
+
+#define GLO_OTHER (0)	// 无初始值，或初始值不是整数
+#define GLO_ROM (1)		// 元素位宽相同的整数表（查找表、S盒等）
+#define GLO_SCALAR (2)	// 整数标量
+
+// 全局变量初始值的分类结果，每个模块只扫描一次
+struct GlobalClass
+{
+	unsigned char Role;	// GLO_ROM / GLO_SCALAR / GLO_OTHER
+	unsigned Width;		// 元素位宽（bit）：表为各元素的位宽，标量为自身位宽，其余为最后一个元素的位宽（非整数为0）
+	unsigned Count;		// 初始值的聚合元素个数，非聚合为0
+	bool LastData;		// 最后一个元素是ConstantData
+};
+
+// 模块级的全局变量污点表，所有帧直接读写同一份
+// 每次写入记录一个版本号，被调函数返回后调用者只需处理版本号晚于调用开始的全局变量
+struct GlobalTaint
+{
+	Module *M;									// 表所属的模块
+	std::vector<GlobalVariable *> Vars;			// 全局变量，按模块中的顺序
+	std::vector<GlobalClass> Class;				// 各全局变量的分类
+	DenseMap<GlobalVariable *, int> Index;		// 全局变量 → Vars中的序号
+	TaintWords Init;							// 入口帧开始分析时的污点类型（2位打包）
+	TaintWords Type;							// 当前污点类型（2位打包），大小在建表后不再改变
+	std::vector<LabelSet> Labels;				// 当前来源标签集合，入口帧开始分析时清空
+	std::vector<unsigned> Version;				// 各全局变量最近一次写入时的版本号
+	unsigned Clock;								// 最近一次写入的版本号
+	std::vector<std::pair<int, unsigned>> Log;	// 写入记录：全局变量序号及写入时的版本号
+
+	GlobalTaint() : M(NULL), Clock(0) {}
+};
+
+// 帧数组按页写时复制：被调帧的各页先指向函数布局中的初值，第一次写入某页时才复制到帧自己的后备区，
+// 因此进入调用只需建立页表和写入实参，离开调用只需处理写入记录中的槽位
+#define TAINT_PAGE_WORDS (8)											// 污点类型每页的字数
+#define TAINT_PAGE_SLOTS (TAINT_PAGE_WORDS * TAINT_SLOTS_PER_WORD)	// 污点类型每页的槽位数
+#define LABEL_PAGE_SLOTS (64)										// 来源标签每页的槽位数
+
+static inline size_t Page_Count(size_t slots, size_t page_slots)
+{
+	return (slots + page_slots - 1) / page_slots;
+}
+
+// 写时复制的页表，页大小为PageElems个T
+template <typename T, size_t PageElems> struct CowPages
+{
+	T **Pages;					// 各页当前的位置（分配自FrameArena）
+	bool *Owned;				// 页已在Backing中，可直接写入
+	T *Backing;					// 帧自己的各页，按页号排列，复制前不初始化
+	std::vector<int> *Log;		// 非空时记录每次写入的槽位（可重复）
+	unsigned long *Copies;		// 非空时累计复制的页数
+
+	T *Own(size_t p)
+	{
+		if (!Owned[p])
+		{
+			T *copy = Backing + p * PageElems;
+			std::copy(Pages[p], Pages[p] + PageElems, copy);
+			Pages[p] = copy;
+			Owned[p] = true;
+			if (Copies)
+				++*Copies;
+		}
+		return Pages[p];
+	}
+};
+
+// 帧中各槽位的污点类型：全局变量区间[GloBegin, GloEnd)映射到GlobalTaint::Type，其余槽位在帧的页中
+// 两者都按2位打包，operator[]返回可读写单个槽位的引用对象，写入时按需复制所在页
+struct SlotTypes : CowPages<uint64_t, TAINT_PAGE_WORDS>
+{
+	uint64_t *Glo;			// 共享的全局变量污点
+	int GloBegin, GloEnd;
+
+	struct Ref
+	{
+		SlotTypes *Frame;	// 非空时槽位在帧的页中，写入前先复制该页
+		uint64_t *Words;	// 槽位所在的页或全局变量污点表
+		int Idx;			// 在Words中的序号
+		int Slot;			// 帧中的序号
+
+		operator unsigned char() const { return Taint_Get(Words, Idx); }
+		Ref &operator=(unsigned char type)
+		{
+			if (Frame)
+				Words = Frame->Write(Slot);
+			Taint_Set(Words, Idx, type);
+			return *this;
+		}
+		Ref &operator=(const Ref &other) { return *this = (unsigned char)other; }
+	};
+
+	Ref operator[](int idx)
+	{
+		if (idx >= GloBegin && idx < GloEnd)
+			return {NULL, Glo, idx - GloBegin, idx};
+		return {this, Pages[idx / TAINT_PAGE_SLOTS], idx % TAINT_PAGE_SLOTS, idx};
+	}
+
+	// 写入槽位idx之前调用：登记写入并复制所在页，返回可写的页
+	uint64_t *Write(int idx)
+	{
+		if (Log)
+			Log->push_back(idx);
+		return Own(idx / TAINT_PAGE_SLOTS);
+	}
+};
+
+// 帧中各槽位的来源标签集合编号，布局与SlotTypes相同：全局变量区间映射到GlobalTaint::Labels
+struct SlotLabels : CowPages<LabelSet, LABEL_PAGE_SLOTS>
+{
+	LabelSet *Glo;
+	int GloBegin, GloEnd;
+
+	struct Ref
+	{
+		SlotLabels *Frame;	// 非空时槽位在帧的页中，写入前先复制该页
+		LabelSet *Elem;
+		int Slot;
+
+		operator LabelSet() const { return *Elem; }
+		Ref &operator=(LabelSet lab)
+		{
+			if (Frame)
+				Elem = Frame->Write(Slot);
+			*Elem = lab;
+			return *this;
+		}
+		Ref &operator=(const Ref &other) { return *this = (LabelSet)other; }
+	};
+
+	Ref operator[](int idx)
+	{
+		if (idx >= GloBegin && idx < GloEnd)
+			return {NULL, Glo + idx - GloBegin, idx};
+		return {this, Pages[idx / LABEL_PAGE_SLOTS] + idx % LABEL_PAGE_SLOTS, idx};
+	}
+
+	LabelSet *Write(int idx)
+	{
+		if (Log)
+			Log->push_back(idx);
+		return Own(idx / LABEL_PAGE_SLOTS) + idx % LABEL_PAGE_SLOTS;
+	}
+};
+
+// 被调帧来源标签的初值页：登记时所有槽位的标签都为空
+static LabelSet Empty_Label_Page[LABEL_PAGE_SLOTS];
+
+// 污点字节码的微操作，每个槽位的传递函数降低为一段连续的微操作
+#define OP_USE_LOAD (0)		// i被load使用，A: load结果槽位
+#define OP_USE_STORE (1)	// i被store使用，A: 写入目标槽位，B: 写入值槽位（可为VAL_Not_Found）
+#define OP_USE_COPY (2)		// i被其他非call指令使用，A: 使用者结果槽位
+#define OP_PTR (3)			// i为指针类型，值类型规范化为指针类型
+#define OP_RET (4)			// i为ret，A: 返回值槽位（可为VAL_Not_Found）
+#define OP_DEF (5)			// i为普通指令，A: 自身槽位；其后的OP_DEF_OPND仅在A为G_ROM_S时执行
+#define OP_DEF_OPND (6)		// A: 操作数槽位
+#define OP_LOAD_OPND (7)	// i为load，A: 自身槽位，B: 指针操作数槽位
+#define OP_LOAD_ROOT (8)	// i为load，A: 自身槽位，B: 指针常量表达式的根全局变量槽位
+#define OP_MEM_DEF (9)		// i为经MemorySSA解析的load，A: 自身槽位，B: 到达的store所写入值的槽位
+#define OP_CTRL (10)		// i为分支条件，A: 控制依赖于该分支的指令槽位
+#define OP_CTRL_STORE (11)	// i为分支条件，A: 控制依赖于该分支的store的写入目标槽位
+
+struct TaintOp
+{
+	unsigned char Kind;
+	int A, B;
+};
+
+// 由函数IR降低得到的污点字节码，各数组均为CSR布局：槽位i的内容位于[Begin[i], Begin[i + 1])
+// 同一函数的各帧槽位布局相同，因此每个函数只降低一次，传播时不再访问LLVM对象
+struct TaintProgram
+{
+	std::vector<unsigned> OpBegin;
+	std::vector<TaintOp> Ops;				// 槽位i的传递函数
+	std::vector<unsigned> DepBegin;
+	std::vector<int> Deps;					// 槽位i变化后需要重新计算的槽位
+	std::vector<unsigned> CallDepBegin;
+	std::vector<int> CallDeps;				// 槽位i变化后需要重新分析的调用点
+	std::vector<Instruction *> Calls;		// 直接调用点，按指令顺序
+	DenseMap<Instruction *, int> CallIndex;	// 调用指令 → Calls中的序号（仅在降低时使用）
+	SmallPtrSet<Value *, 16> MemTracked;	// 内存流由MemorySSA解析的alloca（仅在降低时使用）
+	DenseMap<int, SmallVector<int, 2>> MemDefs;		// load槽位 → 到达的store所写入值的槽位（仅在降低时使用）
+	DenseMap<int, SmallVector<int, 2>> MemUsers;	// 上表的反向，用于登记依赖（仅在降低时使用）
+	DenseMap<int, std::vector<TaintOp>> CtrlOps;	// 分支条件槽位 → 控制依赖的OP_CTRL/OP_CTRL_STORE（仅在降低时使用）
+	SmallPtrSet<Value *, 16> CtrlStored;	// 有受控store的内存对象，不交给MemorySSA（仅在降低时使用）
+	bool SelfCall;							// 函数中存在对自身的调用
+	bool Sliced;							// 已按切片裁剪：传播开始时只标记仍有微操作的槽位
+};
+
+// 函数的帧布局：同一函数各帧的槽位顺序与登记时的初值都相同，第一次进入该函数时登记一次，之后各帧共用
+struct FrameLayout
+{
+	std::vector<Value *> FunInst;			// 参数、全局变量、指令
+	DenseMap<Value *, int> ValIndex;		// Value* → FunInst中的序号（不含全局变量）
+	TaintWords Init;						// 登记时的污点类型，按页补齐；全局变量区间不使用
+	int ArgNum;								// 参数个数
+	int GloNum;								// 全局变量数
+};
+
+//记录function的所有信息
+struct funvalst
+{
+	Value **FunInst;						// 指向function中指令的指针数组（分配自FrameArena，或共用函数布局中的数组）
+	SlotTypes FunInstVal;					// 记录function中指令的污点类型
+	int functionval_cap;					// 数组容量：参数数 + 全局变量数 + 指令数
+	FrameArena::Mark ArenaTop;				// 本帧数组之后的分配区位置，子帧从这里开始分配
+	unsigned char RetType;					// ？？？
+	SlotLabels Labels;						// 各槽位的来源标签集合（-stain-labels）
+	LabelSet RetLabels;						// 返回值的来源标签集合
+	int functionval_num;					// 指令数
+	int functionarg_num;					// 参数个数
+	int functionglo_num;					// 全局变量数
+	DenseMap<Value *, int> *ValIndex;		// Value* → FunInst中的序号（指向OwnIndex或函数布局中的索引）
+	DenseMap<Value *, int> OwnIndex;		// 逐条登记的帧（入口帧）自己的索引
+	std::vector<int> Written;				// 进入后写入过的本帧槽位（可重复），自递归调用返回时按它合并
+	Function *Func;							// 帧所分析的函数
+	const TaintProgram *Prog;				// Func降低后的污点字节码
+	BitVector SlotDirty;					// 待重新计算传递函数的槽位
+	BitVector CallDirty;					// 待重新分析的调用点（Prog->Calls中的序号）
+	bool Root;								// 入口帧：开始分析时重置全局变量污点表
+};
+
+namespace
+{
+	// 污点分析的全部状态与传递函数；自底向上模式下每个工作线程持有一个独立实例
+	struct TaintEngine
+	{
+		char print_flg;					   //是否打印分析过程
+		bool labels;					   //是否传播来源标签（-stain-labels）
+		LabelSets *sets;				   //来源标签集合的共享表，由pass持有
+		SccState *scc;					   //非空时处于自底向上模式
+		GlobalTaint gt;					   //模块级的全局变量污点表
+		const DenseMap<ConstantExpr *, int> *ce_root; //常量表达式 → 根全局变量在模块中的序号，由pass按模块建立
+		funvalst mainst;				   //用于记录主函数指令信息
+		funvalst subfst[MAX_SUB_FUN_DEEP]; //用于记录子函数指令信息
+		FrameArena arena;				   //各帧FunInst/FunInstVal数组的分配区
+		int subdeep;					   //子函数调用深度
+		unsigned long val_evals;		   //槽位传递函数求值次数
+		unsigned long call_evals;		   //调用点传递函数求值次数
+		DenseMap<Function *, StringMap<TaintSummary>> summaries;	//被调函数摘要，按输入上下文索引
+		DenseMap<Function *, std::vector<GlobalVariable *>> relevant_glo; //被调函数摘要依赖的全局变量
+		unsigned long summary_hits;		   //摘要命中次数
+		unsigned long summary_misses;	   //摘要未命中（完整分析被调函数）次数
+		DenseMap<Function *, std::unique_ptr<TaintProgram>> programs;	//各函数降低后的污点字节码
+		unsigned long lowered_funcs;	   //已降低的函数数
+		unsigned long lowered_ops;		   //降低得到的微操作数
+		unsigned long lower_ns;			   //降低耗时
+		unsigned long mssa_allocas;		   //由MemorySSA解析的alloca数
+		unsigned long mssa_loads;		   //由MemorySSA解析的load数
+		unsigned long mssa_edges;		   //store → load边数
+		unsigned long ctrl_branches;	   //有控制依赖的分支数
+		unsigned long ctrl_edges;		   //分支 → 受控槽位边数
+		DenseMap<Function *, std::pair<int, int>> slice_pruned; //各函数被切除的指令槽位数与指令槽位总数
+		TaintBudget *budget;			   //非空时检查预算（-stain-budget-*、-stain-module-budget-*）
+		DenseMap<Function *, std::unique_ptr<FrameLayout>> layouts; //各函数的帧布局
+		funvalst layout_st;				   //登记帧布局用的临时帧
+		unsigned long frame_layouts;	   //登记过的帧布局数
+		unsigned long frames_entered;	   //建立在帧布局之上的帧数
+		unsigned long frame_pages;		   //这些帧的页数
+		unsigned long cow_pages;		   //其中被写入而复制的页数
+		DenseMap<Function *, BudgetHit> budget_hits; //各函数耗尽预算被放宽的记录
+		const CallResolver *icall;		   //非空时间接调用按候选被调函数分析（-stain-icall），由pass按模块建立
+		const ShimTable *shim;			   //模块中的shim API调用点，取数API的间接调用为污点源，由pass按模块建立
+		TaintEngine() : print_flg(0), labels(StainLabels), sets(NULL), scc(NULL), ce_root(NULL), subdeep(0), val_evals(0), call_evals(0),
+						lowered_funcs(0), lowered_ops(0), lower_ns(0), mssa_allocas(0), mssa_loads(0), mssa_edges(0),
+						ctrl_branches(0), ctrl_edges(0), budget(NULL),
+						frame_layouts(0), frames_entered(0), frame_pages(0), cow_pages(0), icall(NULL), shim(NULL) {}
+
+		//初始化funvalst实例的数据成员
+		//数组按F的参数、全局变量和指令数从分配区划出，紧接在调用者帧parent之后；槽位在登记时才赋初值，这里不清零
+		//这样建立的帧逐条登记槽位，各页都在帧自己的后备区中
+		void Clean_st(funvalst *fst, Function *F, funvalst *parent)
+		{
+			Reset_st(fst, F, parent);
+			fst->functionval_cap = F->arg_size() + F->getParent()->global_size() + F->getInstructionCount();
+			fst->FunInst = arena.Allocate<Value *>(fst->functionval_cap);
+			Alloc_Pages(fst, fst->functionval_cap);
+			for (size_t p = 0; p < Page_Count(fst->functionval_cap, TAINT_PAGE_SLOTS); p++)
+			{
+				fst->FunInstVal.Pages[p] = fst->FunInstVal.Backing + p * TAINT_PAGE_WORDS;
+				fst->FunInstVal.Owned[p] = true;
+			}
+			for (size_t p = 0; p < Page_Count(fst->functionval_cap, LABEL_PAGE_SLOTS); p++)
+			{
+				fst->Labels.Pages[p] = fst->Labels.Backing + p * LABEL_PAGE_SLOTS;
+				fst->Labels.Owned[p] = true;
+			}
+			fst->OwnIndex.clear();
+			fst->ValIndex = &fst->OwnIndex;
+			fst->ArenaTop = arena.Save();
+		}
+
+		// 两种建帧方式共同的字段
+		void Reset_st(funvalst *fst, Function *F, funvalst *parent)
+		{
+			if (parent)
+				arena.Release(parent->ArenaTop);
+			else
+				arena.Release({0, 0});
+			fst->FunInstVal.Glo = NULL;
+			fst->FunInstVal.GloBegin = fst->FunInstVal.GloEnd = 0;
+			fst->FunInstVal.Log = NULL;
+			fst->FunInstVal.Copies = NULL;
+			fst->Labels.Glo = NULL;
+			fst->Labels.GloBegin = fst->Labels.GloEnd = 0;
+			fst->Labels.Log = NULL;
+			fst->Labels.Copies = NULL;
+			fst->RetLabels = LABEL_SET_EMPTY;
+			fst->Root = !parent;
+			fst->Func = F;
+			fst->functionval_num = 0;
+			fst->functionarg_num = 0;
+			fst->functionglo_num = 0;
+			fst->RetType = No_state;
+			fst->Written.clear();
+		}
+
+		// 为n个槽位划出两种数组的页表与后备区，页表内容由调用者填写
+		void Alloc_Pages(funvalst *fst, size_t n)
+		{
+			size_t tp = Page_Count(n, TAINT_PAGE_SLOTS), lp = Page_Count(n, LABEL_PAGE_SLOTS);
+			fst->FunInstVal.Pages = arena.Allocate<uint64_t *>(tp);
+			fst->FunInstVal.Owned = arena.Allocate<bool>(tp);
+			fst->FunInstVal.Backing = arena.Allocate<uint64_t>(tp * TAINT_PAGE_WORDS);
+			fst->Labels.Pages = arena.Allocate<LabelSet *>(lp);
+			fst->Labels.Owned = arena.Allocate<bool>(lp);
+			fst->Labels.Backing = arena.Allocate<LabelSet>(lp * LABEL_PAGE_SLOTS);
+		}
+
+		// F的帧布局：第一次进入F时在临时帧中逐条登记（与Clean_st后按参数、全局变量、指令登记的结果相同），再保存下来
+		const FrameLayout &Layout_Of(Function *F, funvalst *parent)
+		{
+			std::unique_ptr<FrameLayout> &layout = layouts[F];
+			if (layout)
+				return *layout;
+			layout.reset(new FrameLayout());
+			funvalst *tmp = &layout_st;
+			Clean_st(tmp, F, parent);
+			tmp->Root = false;
+			Find_All_FunctionArg(F, tmp);
+			Find_All_GloabalVariable(F->getParent(), tmp);
+			Find_All_FunctionVal(F, tmp);
+			layout->FunInst.assign(tmp->FunInst, tmp->FunInst + tmp->functionval_num);
+			layout->ValIndex.swap(tmp->OwnIndex);
+			size_t pages = Page_Count(tmp->functionval_num, TAINT_PAGE_SLOTS);
+			layout->Init.resize(pages * TAINT_PAGE_WORDS);
+			for (size_t p = 0; p < pages; p++)
+				std::copy(tmp->FunInstVal.Pages[p], tmp->FunInstVal.Pages[p] + TAINT_PAGE_WORDS, layout->Init.begin() + p * TAINT_PAGE_WORDS);
+			layout->ArgNum = tmp->functionarg_num;
+			layout->GloNum = tmp->functionglo_num;
+			frame_layouts++;
+			return *layout;
+		}
+
+		// 进入F的一帧：各页指向F的帧布局中的初值，写入时才复制，因此只需建立页表；
+		// 参数按布局中的初值（被调函数为State），由调用者随后写入实参
+		void Enter_Frame(funvalst *fst, Function *F, funvalst *parent)
+		{
+			const FrameLayout &layout = Layout_Of(F, parent);
+			Reset_st(fst, F, parent);
+			int n = layout.FunInst.size();
+			fst->functionval_cap = n;
+			fst->FunInst = const_cast<Value **>(layout.FunInst.data());
+			fst->ValIndex = const_cast<DenseMap<Value *, int> *>(&layout.ValIndex);
+			Alloc_Pages(fst, n);
+			for (size_t p = 0; p < Page_Count(n, TAINT_PAGE_SLOTS); p++)
+			{
+				fst->FunInstVal.Pages[p] = const_cast<uint64_t *>(layout.Init.data()) + p * TAINT_PAGE_WORDS;
+				fst->FunInstVal.Owned[p] = false;
+			}
+			for (size_t p = 0; p < Page_Count(n, LABEL_PAGE_SLOTS); p++)
+			{
+				fst->Labels.Pages[p] = Empty_Label_Page;
+				fst->Labels.Owned[p] = false;
+			}
+			fst->FunInstVal.Log = fst->Labels.Log = &fst->Written;
+			fst->FunInstVal.Copies = fst->Labels.Copies = &cow_pages;
+			fst->functionval_num = n;
+			fst->functionarg_num = layout.ArgNum;
+			Map_Globals(fst, layout.ArgNum, layout.GloNum);
+			fst->ArenaTop = arena.Save();
+			frames_entered++;
+			frame_pages += Page_Count(n, TAINT_PAGE_SLOTS) + Page_Count(n, LABEL_PAGE_SLOTS);
+		}
+
+		// 将v登记到FunInst末尾，同时建立索引（序号由调用者递增）
+		void Insert_Val(Value *v, funvalst *fst)
+		{
+			if (fst->functionval_num >= fst->functionval_cap)
+				report_fatal_error("stain: frame of " + fst->Func->getName() + " overflows its slot capacity");
+			fst->FunInst[fst->functionval_num] = v;
+			fst->FunInstVal[fst->functionval_num] = No_state;
+			fst->Labels[fst->functionval_num] = LABEL_SET_EMPTY;
+			fst->ValIndex->try_emplace(v, fst->functionval_num);
+		}
+
+		void Stain_Set(Function *F, funvalst *fst)
+		{
+			Argument *arg;
+
+			for (Function::arg_iterator i = F->arg_begin(), e = F->arg_end(); i != e; ++i)
+			{
+				arg = &*i;
+				Insert_Val(arg, fst);
+				//if(i->getType()->getTypeID() != Type::PointerTyID)fst->FunInstVal[fst->functionval_num] = State;
+				//else fst->FunInstVal[fst->functionval_num] = State;//which don't know the data struct
+				if (print_flg)
+					errs() << "arg: %" << fst->functionval_num << "\n";
+				fst->functionval_num++;
+			}
+			fst->FunInstVal[0] = G_ROM_S;
+			// sret参数是入口函数的返回值，输入标签来自shim取数API
+			if (labels && !F->hasStructRetAttr())
+				fst->Labels[0] = sets->Site(LABEL_INPUT, NULL);
+			fst->functionarg_num = fst->functionval_num;
+			if (print_flg)
+				errs() << "------------------------------------------\n";
+		}
+
+		// 判断g是否为全局变量，也有可能是常量
+		// 初始化结构中每个元素具有相同的位宽
+		// 逐个元素扫描g的初始值一次，得到元素个数、位宽和分类
+		// 原IS_ROM的判定：初始化结构中每个元素都是整数且具有相同的位宽
+		static GlobalClass Classify_Global(GlobalVariable *g)
+		{
+			GlobalClass gc = {GLO_OTHER, 0, 0, false};
+			if (!g->hasInitializer())
+				return gc;
+			Constant *init = g->getInitializer();
+			bool same_width = true;
+			// Constant *getInitializer(): Returns the initial value for a GlobalVariable
+			while (Constant *CT = init->getAggregateElement(gc.Count))
+			{
+				ConstantInt *CI = dyn_cast<ConstantInt>(CT);
+				if (!CI || (gc.Count > 0 && CI->getBitWidth() != gc.Width))
+					same_width = false;
+				gc.Width = CI ? CI->getBitWidth() : 0;
+				gc.LastData = isa<ConstantData>(CT);
+				gc.Count++;
+			}
+			if (gc.Count > 0 && same_width)
+				gc.Role = GLO_ROM;
+			else if (ConstantInt *CI = dyn_cast<ConstantInt>(init))
+			{
+				gc.Role = GLO_SCALAR;
+				gc.Width = CI->getBitWidth();
+			}
+			return gc;
+		}
+
+		//获取module中所有全局变量并对被污染情况进行初始化，建立M的全局变量污点表（按模块中的顺序编号）
+		void Init_Global_Table(Module *M)
+		{
+			gt.M = M;
+			gt.Vars.clear();
+			gt.Class.clear();
+			gt.Index.clear();
+			gt.Init.assign(Taint_Words(M->global_size()), 0);
+			for (Module::global_iterator i = M->global_begin(), e = M->global_end(); i != e; ++i)
+			{
+				if (print_flg)
+					errs() << gt.Vars.size();
+				gt.Index[&*i] = gt.Vars.size();
+				gt.Vars.push_back(&*i);
+				GlobalClass gc = Classify_Global(&*i);
+				gt.Class.push_back(gc);
+				unsigned l = gc.Count ? gc.Count : 1; //have only single value;
+				if (print_flg)
+					errs() << i->getName() << " ";
+				// 若该全局变量是变量类型，则标记为G_ROM_N
+				if (gc.Role == GLO_ROM)
+				{
+					Taint_Set(gt.Init.data(), gt.Vars.size() - 1, G_ROM_N);
+					if (print_flg)
+						errs() << " " << gc.Width / 8 << "Byte X "
+							   << "[" << l << "] G_ROM\n";
+				}
+				// 若该全局变量不是变量类型（常量），则标记为No_state
+				else
+				{
+					Taint_Set(gt.Init.data(), gt.Vars.size() - 1, No_state);
+					if (print_flg && gc.Role == GLO_SCALAR)
+						errs() << gc.Width / 8 << "Byte X "
+							   << "[" << l << "] State\n";
+				}
+			}
+			gt.Type = gt.Init;
+			gt.Labels.assign(gt.Vars.size(), LABEL_SET_EMPTY);
+			gt.Version.assign(gt.Vars.size(), 0);
+			gt.Clock = 0;
+			gt.Log.clear();
+			if (print_flg)
+				errs() << "------------------------------------------\n";
+		}
+
+		// 将全局变量顺序加入FunInst数组；其污点类型不在帧中复制，直接映射到共享的全局变量污点表
+		void Find_All_GloabalVariable(Module *M, funvalst *fst)
+		{
+			if (gt.M != M)
+				Init_Global_Table(M);
+			int n = gt.Vars.size();
+			if (fst->functionval_num + n > fst->functionval_cap)
+				report_fatal_error("stain: frame of " + fst->Func->getName() + " overflows its slot capacity");
+			std::copy(gt.Vars.begin(), gt.Vars.end(), fst->FunInst + fst->functionval_num);
+			Map_Globals(fst, fst->functionval_num, n);
+			fst->functionval_num += n;
+		}
+
+		// 帧中从begin开始的n个槽位映射到共享的全局变量污点表
+		void Map_Globals(funvalst *fst, int begin, int n)
+		{
+			fst->FunInstVal.Glo = gt.Type.data();
+			fst->FunInstVal.GloBegin = begin;
+			fst->FunInstVal.GloEnd = begin + n;
+			fst->Labels.Glo = gt.Labels.data();
+			fst->Labels.GloBegin = fst->FunInstVal.GloBegin;
+			fst->Labels.GloEnd = fst->FunInstVal.GloEnd;
+			fst->functionglo_num = n;
+			// 入口帧从初始状态开始
+			if (fst->Root)
+			{
+				std::copy(gt.Init.begin(), gt.Init.end(), gt.Type.begin());
+				std::fill(gt.Labels.begin(), gt.Labels.end(), LABEL_SET_EMPTY);
+				std::fill(gt.Version.begin(), gt.Version.end(), 0);
+				gt.Clock = 0;
+				gt.Log.clear();
+			}
+		}
+
+		// 全局变量g（模块中的序号）被写入后登记版本号
+		void Stamp_Global(int g)
+		{
+			gt.Version[g] = ++gt.Clock;
+			gt.Log.push_back({g, gt.Clock});
+		}
+
+		// 对写入记录中从mark开始、之后未被再次写入的每个全局变量调用fn
+		template <typename Fn> void For_Global_Writes(size_t mark, Fn fn)
+		{
+			for (size_t k = mark; k < gt.Log.size(); k++)
+				if (gt.Version[gt.Log[k].first] == gt.Log[k].second)
+					fn(gt.Log[k].first);
+		}
+
+		// 对调用点I的每个被调函数调用fn：直接调用为其callee，-stain-icall下间接调用为解析出的候选
+		template <typename Fn> void For_Callees(Instruction *I, Fn fn)
+		{
+			if (Function *callee = dyn_cast<Function>(I->getOperand(I->getNumOperands() - 1)))
+				fn(callee);
+			else if (icall)
+				for (Function *callee : icall->Find_Targets(I))
+					fn(callee);
+		}
+
+		// 遍历basicblock中指令并初始化其污点类型
+		// 除了store等（user为0的）的指令
+		void Serch_Blocks(BasicBlock *BB_c, funvalst *fst)
+		{
+			Instruction *Inst;
+			int i;
+			for (BasicBlock::iterator i2 = BB_c->begin(), e2 = BB_c->end(); i2 != e2; ++i2)
+			{
+				Inst = &*i2;
+				// store和br指令并没有value实例，will not be used
+				// 推测Inst这里指的就是指令的执行结果或者返回值
+				if (Inst->hasNUsesOrMore(1))
+				{                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                     
+					if (Inst->getOpcode() == Instruction::Alloca)
+					{
+						Insert_Val(Inst, fst);
+						fst->FunInstVal[fst->functionval_num] = G_ROM_N;
+						fst->functionval_num++;
+					}
+					else
+					{
+						Insert_Val(Inst, fst);
+						if (Inst->getType()->isPointerTy())
+							fst->FunInstVal[fst->functionval_num] = G_ROM_N;
+						else
+							fst->FunInstVal[fst->functionval_num] = No_state;
+						fst->functionval_num++;
+					}
+				}
+				else if (Inst->getOpcode() == Instruction::Ret)
+				{
+					// 如果返回值非空
+					if (Inst->getNumOperands())
+					{
+						Insert_Val(Inst, fst);
+						if (Inst->getOperand(0)->getType()->isPointerTy())
+							fst->FunInstVal[fst->functionval_num] = G_ROM_N;
+						else
+							fst->FunInstVal[fst->functionval_num] = No_state;
+						fst->functionval_num++;
+					}
+					else
+					{
+						Insert_Val(Inst, fst);
+						fst->FunInstVal[fst->functionval_num] = No_state;
+						fst->functionval_num++;
+					}
+				}
+			}
+		}
+
+		// 遍历function中的所有basicblock，调用Serch_Blocks初始化其污点类型
+		void Find_All_FunctionVal(Function *F, funvalst *fst)
+		{
+			BasicBlock *BB_c;
+			for (Function::iterator i = F->begin(), e = F->end(); i != e; ++i)
+			{
+				BB_c = &*i;
+				Serch_Blocks(BB_c, fst);
+			}
+		}
+
+		// 返回所有使用v的指令
+		Value *Find_Used_Inst(Value *v)
+		{
+			for (User *u : v->users())
+			{
+				if (dyn_cast<Instruction>(u))
+					return u;
+				// ConstantExpr: 由使用v初始化的常量值。
+				// https://lists.llvm.org/pipermail/llvm-dev/2013-April/060949.html
+				else if (dyn_cast<ConstantExpr>(u))
+					Find_Used_Inst(u);
+			}
+			return NULL;
+		}
+
+		// 确保v（如果是常量表达式则继续追溯def-use）是Instruction类型
+		Value *Used_to_Inst(Value *v)
+		{
+			if (dyn_cast<Instruction>(v))
+				return v;
+			if (dyn_cast<ConstantExpr>(v))
+			{
+				for (User *u : v->users())
+				{
+					if (dyn_cast<Instruction>(u))
+						return u;
 					else if (dyn_cast<ConstantExpr>(u))
 						Find_Used_Inst(u);
 				}
 			}
-			return NULL;
+			return NULL;
+		}
+
+		// 找出指定value在functionval_num中的序号
+		int Find_Val(Value *v, funvalst *fst)
+		{
+			auto it = fst->ValIndex->find(v);
+			if (it != fst->ValIndex->end())
+				return it->second;
+			// 全局变量不登记在帧的索引中，按其在模块中的序号定位
+			if (fst->FunInstVal.GloEnd > fst->FunInstVal.GloBegin)
+				if (GlobalVariable *g = dyn_cast<GlobalVariable>(v))
+				{
+					auto gi = gt.Index.find(g);
+					if (gi != gt.Index.end())
+						return fst->FunInstVal.GloBegin + gi->second;
+				}
+			return VAL_Not_Found;
+		}
+
+		// 找出指定value的污点类型
+		unsigned char Find_Val_Type(Value *u, funvalst *fst)
+		{
+			int i = Find_Val(u, fst);
+			if (i == VAL_Not_Found)
+				return VAL_Not_Found;
+			return fst->FunInstVal[i];
+		}
+
+		// 常量表达式v的根全局变量在fst中的槽位；全局变量按模块中的顺序紧接在参数之后
+		int Find_Const_Root(Value *v, funvalst *fst)
+		{
+			ConstantExpr *CE = dyn_cast<ConstantExpr>(v);
+			if (!CE || !ce_root)
+				return VAL_Not_Found;
+			auto it = ce_root->find(CE);
+			if (it == ce_root->end() || it->second < 0)
+				return VAL_Not_Found;
+			return fst->functionarg_num + it->second;
+		}
+
+		// 沿常量表达式的操作数（含嵌套的GEP/bitcast）找到第一个全局变量，返回其在模块中的序号，找不到为-1
+		static int Resolve_Const_Root(ConstantExpr *CE, DenseMap<ConstantExpr *, int> &roots, DenseMap<GlobalVariable *, int> &glo_ord)
+		{
+			auto it = roots.find(CE);
+			if (it != roots.end())
+				return it->second;
+			int root = -1;
+			for (Value *op : CE->operands())
+			{
+				if (GlobalVariable *g = dyn_cast<GlobalVariable>(op))
+					root = glo_ord[g];
+				else if (ConstantExpr *sub = dyn_cast<ConstantExpr>(op))
+					root = Resolve_Const_Root(sub, roots, glo_ord);
+				if (root != -1)
+					break;
+			}
+			roots[CE] = root;
+			return root;
+		}
+
+		// 为M中指令引用的所有常量表达式预先求出根全局变量，分析期间只读
+		static void Build_Const_Root(Module &M, DenseMap<ConstantExpr *, int> &roots)
+		{
+			DenseMap<GlobalVariable *, int> glo_ord;
+			int k = 0;
+			for (GlobalVariable &g : M.globals())
+				glo_ord[&g] = k++;
+			roots.clear();
+			for (Function &F : M)
+				for (Instruction &I : instructions(F))
+					for (Value *op : I.operands())
+						if (ConstantExpr *CE = dyn_cast<ConstantExpr>(op))
+							Resolve_Const_Root(CE, roots, glo_ord);
+		}
+
+		// 在逐步增大的合成帧上测量Find_Val的平均查找耗时，与被分析的函数无关，并与原来按槽位顺序的线性扫描对比
+		// 键为不属于任何函数的Argument，不进入LLVMContext的常量表；按跨步顺序查找，避免总是命中相邻的桶
+		void Bench_Find_Val(LLVMContext &ctx)
+		{
+			const unsigned long min_lookups = 1 << 22, min_scan_steps = 1UL << 28;
+			Type *ty = Type::getInt64Ty(ctx);
+			std::vector<unique_value> owned;
+			std::vector<Value *> keys;
+			funvalst bench;
+			bench.ValIndex = &bench.OwnIndex;
+			bench.FunInstVal.GloBegin = bench.FunInstVal.GloEnd = 0;
+			auto scan = [&](Value *v, unsigned n) {
+				for (unsigned k = 0; k < n; k++)
+					if (keys[k] == v)
+						return (int)k;
+				return VAL_Not_Found;
+			};
+			for (unsigned n = 1 << 8; n <= (1 << 18); n <<= 2)
+			{
+				while (keys.size() < n)
+				{
+					owned.emplace_back(new Argument(ty));
+					keys.push_back(owned.back().get());
+					bench.OwnIndex.try_emplace(keys.back(), keys.size() - 1);
+				}
+				unsigned long lookups = 0, hits = 0;
+				auto start = std::chrono::steady_clock::now();
+				while (lookups < min_lookups)
+				{
+					for (unsigned long i = 0; i < n; i++)
+						hits += Find_Val(keys[(i * 7919UL) % n], &bench) != VAL_Not_Found;
+					lookups += n;
+				}
+				double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+				// 线性扫描平均比较n/2次，按比较次数限定查找次数
+				unsigned long scans = std::max(256UL, min_scan_steps / n), scan_hits = 0;
+				start = std::chrono::steady_clock::now();
+				for (unsigned long i = 0; i < scans; i++)
+					scan_hits += scan(keys[(i * 7919UL) % n], n) != VAL_Not_Found;
+				double scan_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+				errs() << "[bench] Find_Val slots: " << n << " lookups: " << lookups << " hits: " << hits
+					   << " avg: " << format("%.1f", ns / lookups) << " ns, linear scan lookups: " << scans
+					   << " hits: " << scan_hits << " avg: " << format("%.1f", scan_ns / scans) << " ns\n";
+			}
+		}
+
+		// 遍历函数参数，污染了一个指针类型的参数变量
+		void Find_All_FunctionArg(Function *F, funvalst *fst)
+		{
+			Argument *arg;
+			unsigned int l;
+			//find all of the global variable
+			for (Function::arg_iterator i = F->arg_begin(), e = F->arg_end(); i != e; ++i)
+			{
+				arg = &*i;
+				Insert_Val(arg, fst);
+				if (i->getType()->getTypeID() != Type::PointerTyID)
+					fst->FunInstVal[fst->functionval_num] = State;
+				else
+					fst->FunInstVal[fst->functionval_num] = State; //which don't know the data struct
+				if (print_flg)
+					errs() << "arg: %" << fst->functionval_num << "\n";
+				fst->functionval_num++;
+			}
+			fst->functionarg_num = fst->functionval_num;
+			if (print_flg)
+				errs() << "------------------------------------------\n";
+		}
+
+		void Print_Type(int i)
+		{
+			if (i == No_state)
+				errs() << "NS";
+			else if (i == G_ROM_N)
+				errs() << "GRN";
+			else if (i == G_ROM_S)
+				errs() << "GRS";
+			else if (i == State)
+				errs() << "ST";
+		}
+
+		// 输出函数内所有指令及污点类型
+		void Print_Function(Function *F, funvalst *fst)
+		{
+			unsigned int br_num, op_num, rom_num;
+			br_num = op_num = rom_num = 0;
+			errs() << "Function " << F->getName() << '\n';
+			BasicBlock *BB_c;
+			int j;
+			// functionarg按照参数，全局，局部变量的顺序计数
+			errs() << "arg\n";
+			for (int valindex = 0; valindex < fst->functionarg_num; valindex++)
+			{
+				errs() << "[" << valindex << "]";
+				Print_Type(fst->FunInstVal[valindex]);
+				errs() << "\n";
+			}
+			errs() << "glo\n";
+			for (int valindex = fst->functionarg_num; valindex < fst->functionglo_num; valindex++)
+			{
+				errs() << "[" << valindex << "]";
+				Print_Type(fst->FunInstVal[valindex]);
+				errs() << "\n";
+			}
+			errs() << "body\n";
+			for (Function::iterator i = F->begin(), e = F->end(); i != e; ++i)
+			{
+				BB_c = &*i;
+				Instruction *Inst;
+				for (BasicBlock::iterator i2 = BB_c->begin(), e2 = BB_c->end(); i2 != e2; ++i2) 
+				{
+					char block_split = 0;
+					Inst = &*i2;
+					errs() << Inst->getOpcodeName();
+					
+					// 如果是call指令，则输出跳转函数名称（最后一个参数）
+					if (Inst->getOpcode() == llvm::Instruction::Call)
+					{
+						if (dyn_cast<Function>(Inst->getOperand(Inst->getNumOperands() - 1)))
+							errs() << " Function " << Inst->getNumOperands() << " ";
+					}
+
+					// 如果是br指令且指令参数为污点类型，则说明存在风险
+					if (llvm::Instruction::Br == Inst->getOpcode() && 
+						Find_Val(Inst->getOperand(0), fst) != VAL_Not_Found && 
+						((fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == State) || 
+						(fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == G_ROM_S)))
+					{
+						errs() << " [Br time atack may be! ] <" << br_num << ">";
+						br_num++;
+					}
+
+					// 如果是一般指令则输出指令名称和污点类型，以及指令参数（显示为序号）的污点类型
+					// 若指令参数并未被标记为污点或非污点，则显示为常量（CT）
+					if (Find_Val(Inst, fst) != VAL_Not_Found)
+					{
+						errs() << " ( " << Find_Val(Inst, fst) << " ";
+						Print_Type((int)fst->FunInstVal[Find_Val(Inst, fst)]);
+						errs() << " " << (int)Inst->getType()->getTypeID() << " ) ";
+					}
+
+					for (int j = 0; j < Inst->getNumOperands(); j++)
+					{
+						if (Find_Val(Inst->getOperand(j), fst) != VAL_Not_Found)
+						{
+							errs() << " [ " << Find_Val(Inst->getOperand(j), fst) << " ";
+							Print_Type((int)fst->FunInstVal[Find_Val(Inst->getOperand(j), fst)]);
+							errs() << " ] ";
+						}
+						else
+							errs() << " [ CT ] ";
+					}
+					errs() << "\n";
+					if (block_split == 1)
+						break;
+				}
+				errs() << "block end\n";
+			}
+			errs() << "Function " << F->getName() << " br attack :" << br_num << '\n';
+		}
+
+		// v是否被污染且带有标签lab：各检测项在汇点按自己的标签查询
+		bool Has_Label(Value *v, funvalst *fst, TaintLabels lab)
+		{
+			int k = Find_Val(v, fst);
+			return k != VAL_Not_Found && Is_Tainted(fst->FunInstVal[k]) && (sets->Kind(fst->Labels[k]) & lab);
+		}
+
+		// 按标签输出汇点：被污染的条件分支、全局变量和返回值，以及到达这些分支的来源调用点个数
+		void Print_Labels(Function *F, funvalst *fst)
+		{
+			for (int l = 0; l < LABEL_KINDS; l++)
+			{
+				TaintLabels lab = 1 << l;
+				unsigned br_num = 0, glo_num = 0;
+				LabelSet br_sites = LABEL_SET_EMPTY;
+				for (Instruction &I : instructions(F))
+					if (BranchInst *BI = dyn_cast<BranchInst>(&I))
+						if (BI->isConditional() && Has_Label(BI->getCondition(), fst, lab))
+						{
+							br_num++;
+							br_sites = sets->Union(br_sites, fst->Labels[Find_Val(BI->getCondition(), fst)]);
+						}
+				for (int g = 0; g < fst->functionglo_num; g++)
+					if (Is_Tainted(fst->FunInstVal[fst->Labels.GloBegin + g]) && (sets->Kind(fst->Labels[fst->Labels.GloBegin + g]) & lab))
+						glo_num++;
+				bool ret = Is_Tainted(fst->RetType) && (sets->Kind(fst->RetLabels) & lab);
+				errs() << "label " << Label_Names[l] << ": " << br_num << " branches from " << sets->Count(br_sites, lab)
+					   << " sites, " << glo_num << " globals" << (ret ? ", return value" : "") << "\n";
+			}
+			// 共享表的开销与每个槽位各存一份集合相比
+			size_t shared = sets->Bytes() + fst->functionval_num * sizeof(LabelSet);
+			std::vector<LabelSet> slots(fst->functionval_num);
+			for (int k = 0; k < fst->functionval_num; k++)
+				slots[k] = fst->Labels[k];
+			size_t unshared = sets->Unshared_Bytes(slots.data(), slots.size());
+			unsigned long lookups = sets->UnionHits + sets->UnionMisses;
+			errs() << "label sets: " << sets->Sets.size() << " sets over " << sets->Elems.size() << " sites, union cache "
+				   << sets->UnionHits << " hits / " << lookups << " ("
+				   << format("%.1f", lookups ? 100.0 * sets->UnionHits / lookups : 0.0) << "%), entry frame "
+				   << shared / 1024 << " KB shared vs " << unshared / 1024 << " KB per-slot\n";
+		}
+
+		// 降低时收集依赖：槽位k的变化会影响哪些传递函数（k自身、k的使用者及其操作数、k的操作数）
+		void Dep_Slot(Value *v, funvalst *fst, TaintProgram &P)
+		{
+			int k = Find_Val(v, fst);
+			if (k != VAL_Not_Found)
+				P.Deps.push_back(k);
+		}
+
+		void Dep_Operands(Instruction *I, funvalst *fst, TaintProgram &P)
+		{
+			for (Value *op : I->operands())
+			{
+				Dep_Slot(op, fst, P);
+				// load/store经由常量表达式访问全局变量时，读取的是表达式的操作数
+				if (ConstantExpr *CE = dyn_cast<ConstantExpr>(op))
+					for (Value *cop : CE->operands())
+						Dep_Slot(cop, fst, P);
+			}
+		}
+
+		void Dep_User(Instruction *U, funvalst *fst, TaintProgram &P)
+		{
+			if (U->getFunction() != fst->Func)
+				return;
+			Dep_Slot(U, fst, P);
+			Dep_Operands(U, fst, P);
+			auto it = P.CallIndex.find(U);
+			if (it != P.CallIndex.end())
+				P.CallDeps.push_back(it->second);
+		}
+
+		// 常量表达式链上的使用者都按根全局变量登记
+		void Dep_Const_User(ConstantExpr *CE, funvalst *fst, TaintProgram &P)
+		{
+			for (User *u : CE->users())
+			{
+				if (Instruction *U = dyn_cast<Instruction>(u))
+					Dep_User(U, fst, P);
+				else if (ConstantExpr *sub = dyn_cast<ConstantExpr>(u))
+					Dep_Const_User(sub, fst, P);
+			}
+		}
+
+		void Dep_Collect(int k, funvalst *fst, TaintProgram &P)
+		{
+			Value *v = fst->FunInst[k];
+			for (User *u : v->users())
+			{
+				if (Instruction *U = dyn_cast<Instruction>(u))
+					Dep_User(U, fst, P);
+				else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(u))
+					Dep_Const_User(CE, fst, P);
+			}
+			if (Instruction *I = dyn_cast<Instruction>(v))
+			{
+				Dep_Operands(I, fst, P);
+				auto it = P.CallIndex.find(I);
+				if (it != P.CallIndex.end())
+					P.CallDeps.push_back(it->second);
+			}
+			// 经MemorySSA读到k所写入值的load
+			auto mu = P.MemUsers.find(k);
+			if (mu != P.MemUsers.end())
+				P.Deps.insert(P.Deps.end(), mu->second.begin(), mu->second.end());
+			// 控制依赖于以k为条件的分支的槽位
+			auto ctrl = P.CtrlOps.find(k);
+			if (ctrl != P.CtrlOps.end())
+				for (const TaintOp &op : ctrl->second)
+					P.Deps.push_back(op.A);
+		}
+
+		// 把槽位i的传递函数降低为微操作，顺序与逐条解释IR时相同：先沿i的使用者传播，再处理i自身的指令
+		void Lower_Slot(funvalst *fst, int i, TaintProgram &P)
+		{
+			Function *F = fst->Func;
+			Value *v = fst->FunInst[i];
+			for (User *u : v->users())
+			{
+				Instruction *Inst = (Instruction *)Used_to_Inst(u);
+				// 这里只处理函数内传播
+				if (!Inst || Inst->getParent()->getParent() != F)
+					continue;
+				if (Inst->getOpcode() == llvm::Instruction::Load)
+				{
+					if (Find_Val(Inst, fst) != VAL_Not_Found && !Mem_Tracked(P, Inst->getOperand(0)))
+						P.Ops.push_back({OP_USE_LOAD, Find_Val(Inst, fst), VAL_Not_Found});
+				}
+				else if (Inst->getOpcode() == llvm::Instruction::Store)
+				{
+					// 写入MemorySSA解析的alloca时由读到它的load直接取值
+					if (Mem_Tracked(P, Inst->getOperand(1)))
+						continue;
+					// 如果是写入已被统计过的指针变量的地址，target_index为对应的序号
+					int target_index = Find_Val(Inst->getOperand(1), fst);
+					if (target_index == VAL_Not_Found)
+						target_index = Find_Const_Root(Inst->getOperand(1), fst);
+					if (target_index != VAL_Not_Found)
+						P.Ops.push_back({OP_USE_STORE, target_index, Find_Val(Inst->getOperand(0), fst)});
+				}
+				else if (Inst->getOpcode() != llvm::Instruction::Call)
+				{
+					if (Find_Val(Inst, fst) != VAL_Not_Found)
+						P.Ops.push_back({OP_USE_COPY, Find_Val(Inst, fst), VAL_Not_Found});
+				}
+			}
+
+			if (!P.CtrlOps.empty())
+			{
+				auto ctrl = P.CtrlOps.find(i);
+				if (ctrl != P.CtrlOps.end())
+					P.Ops.insert(P.Ops.end(), ctrl->second.begin(), ctrl->second.end());
+			}
+
+			if (v->getType()->isPointerTy())
+				P.Ops.push_back({OP_PTR, VAL_Not_Found, VAL_Not_Found});
+
+			Instruction *FInst = dyn_cast<Instruction>(v);
+			if (!FInst)
+				return;
+			int self = Find_Val(FInst, fst);
+			if (FInst->getOpcode() == llvm::Instruction::Ret)
+			{
+				if (FInst->getNumOperands())
+					P.Ops.push_back({OP_RET, Find_Val(FInst->getOperand(0), fst), VAL_Not_Found});
+			}
+			else if (FInst->getOpcode() != llvm::Instruction::Call && FInst->getOpcode() != llvm::Instruction::Store && FInst->getOpcode() != llvm::Instruction::Load && FInst->getOpcode() != llvm::Instruction::Alloca)
+			{
+				if (self == VAL_Not_Found)
+					return;
+				P.Ops.push_back({OP_DEF, self, VAL_Not_Found});
+				for (Value *op : FInst->operands())
+					if (Find_Val(op, fst) != VAL_Not_Found)
+						P.Ops.push_back({OP_DEF_OPND, Find_Val(op, fst), VAL_Not_Found});
+			}
+			else if (FInst->getOpcode() == llvm::Instruction::Load && self != VAL_Not_Found)
+			{
+				if (Mem_Tracked(P, FInst->getOperand(0)))
+				{
+					for (int def : P.MemDefs.lookup(self))
+						P.Ops.push_back({OP_MEM_DEF, self, def});
+					return;
+				}
+				for (Value *op : FInst->operands())
+				{
+					if (Find_Val(op, fst) != VAL_Not_Found)
+						P.Ops.push_back({OP_LOAD_OPND, self, Find_Val(op, fst)});
+					// 常量表达式（全局变量上的GEP/bitcast链）按其根全局变量处理
+					else if (Find_Const_Root(op, fst) != VAL_Not_Found)
+						P.Ops.push_back({OP_LOAD_ROOT, self, Find_Const_Root(op, fst)});
+				}
+			}
+		}
+
+		bool Mem_Tracked(const TaintProgram &P, Value *ptr)
+		{
+			return !P.MemTracked.empty() && P.MemTracked.count(getUnderlyingObject(ptr));
+		}
+
+		// alloca（及其GEP/bitcast）只作为load/store的地址使用时，对它的写入都是可见的store
+		static bool Mem_Promotable(AllocaInst *AI)
+		{
+			SmallVector<Value *, 8> stack;
+			stack.push_back(AI);
+			while (!stack.empty())
+			{
+				Value *p = stack.pop_back_val();
+				for (User *u : p->users())
+				{
+					if (isa<LoadInst>(u))
+						continue;
+					if (StoreInst *SI = dyn_cast<StoreInst>(u))
+					{
+						if (SI->getValueOperand() == p)
+							return false;
+						continue;
+					}
+					if (isa<GetElementPtrInst>(u) || isa<BitCastInst>(u))
+					{
+						stack.push_back(u);
+						continue;
+					}
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// 用MemorySSA求出F中可解析alloca上每个load的到达store（经MemoryPhi展开；非必然别名的store之后继续向上查找）
+		// AssumptionCache等分析会在LLVMContext中登记值句柄，不能在工作线程中调用：自底向上模式由主线程预先求出
+		static void Mem_Flow(Function *F, MemFlow &flow)
+		{
+			SmallPtrSet<Value *, 16> promotable;
+			for (Instruction &I : instructions(F))
+				if (AllocaInst *AI = dyn_cast<AllocaInst>(&I))
+					if (Mem_Promotable(AI))
+						promotable.insert(AI);
+			if (promotable.empty())
+				return;
+			TargetLibraryInfoImpl TLII(Triple(F->getParent()->getTargetTriple()));
+			TargetLibraryInfo TLI(TLII);
+			AssumptionCache AC(*F);
+			DominatorTree DT(*F);
+			BasicAAResult BAR(F->getParent()->getDataLayout(), *F, TLI, AC, &DT);
+			AAResults AA(TLI);
+			AA.addAAResult(BAR);
+			MemorySSA MSSA(*F, &AA, &DT);
+			MemorySSAWalker *walker = MSSA.getWalker();
+			for (Instruction &I : instructions(F))
+			{
+				LoadInst *LI = dyn_cast<LoadInst>(&I);
+				if (!LI || !promotable.count(getUnderlyingObject(LI->getPointerOperand())))
+					continue;
+				flow.emplace_back(LI, SmallVector<StoreInst *, 2>());
+				MemoryLocation loc = MemoryLocation::get(LI);
+				SmallVector<MemoryAccess *, 8> work;
+				SmallPtrSet<MemoryAccess *, 8> seen;
+				work.push_back(walker->getClobberingMemoryAccess(LI));
+				while (!work.empty())
+				{
+					MemoryAccess *acc = work.pop_back_val();
+					if (!seen.insert(acc).second || MSSA.isLiveOnEntryDef(acc))
+						continue;
+					if (MemoryPhi *phi = dyn_cast<MemoryPhi>(acc))
+					{
+						for (unsigned k = 0; k < phi->getNumIncomingValues(); k++)
+							work.push_back(walker->getClobberingMemoryAccess(phi->getIncomingValue(k), loc));
+						continue;
+					}
+					MemoryDef *def = cast<MemoryDef>(acc);
+					StoreInst *SI = dyn_cast_or_null<StoreInst>(def->getMemoryInst());
+					// 可解析的alloca只会被store写入
+					if (!SI)
+						continue;
+					flow.back().second.push_back(SI);
+					if (AA.alias(MemoryLocation::get(SI), loc) != AliasResult::MustAlias)
+						work.push_back(walker->getClobberingMemoryAccess(def->getDefiningAccess(), loc));
+				}
+			}
+		}
+
+		// F中可解析alloca（有受控store的除外）上各load的到达store写入P.MemDefs/MemUsers，槽位按fst的布局
+		void Mem_Resolve(Function *F, funvalst *fst, TaintProgram &P)
+		{
+			for (Instruction &I : instructions(F))
+				if (AllocaInst *AI = dyn_cast<AllocaInst>(&I))
+					if (Mem_Promotable(AI) && !P.CtrlStored.count(AI))
+						P.MemTracked.insert(AI);
+			if (P.MemTracked.empty())
+				return;
+			MemFlow own;
+			const MemFlow *flow = &own;
+			if (scc)
+			{
+				auto it = scc->MemFlows.find(F);
+				if (it == scc->MemFlows.end())
+					return;
+				flow = &it->second;
+			}
+			else
+				Mem_Flow(F, own);
+			mssa_allocas += P.MemTracked.size();
+			for (auto &load : *flow)
+			{
+				int self = Find_Val(load.first, fst);
+				if (self == VAL_Not_Found || !Mem_Tracked(P, load.first->getPointerOperand()))
+					continue;
+				mssa_loads++;
+				for (StoreInst *SI : load.second)
+				{
+					int v = Find_Val(SI->getValueOperand(), fst);
+					if (v == VAL_Not_Found)
+						continue;
+					P.MemDefs[self].push_back(v);
+					P.MemUsers[v].push_back(self);
+					mssa_edges++;
+				}
+			}
+		}
+
+		// 由后支配树求控制依赖：分支块B的各后继沿后支配树上溯、到ipdom(B)之前经过的块都控制依赖于B
+		// 结果按分支条件槽位写入P.CtrlOps，随降低后的程序缓存，传播时只需执行这些微操作，不再遍历CFG
+		void Ctrl_Resolve(Function *F, funvalst *fst, TaintProgram &P)
+		{
+			PostDominatorTree PDT(*F);
+			for (BasicBlock &B : *F)
+			{
+				Instruction *T = B.getTerminator();
+				Value *cond = NULL;
+				if (BranchInst *BI = dyn_cast<BranchInst>(T))
+					cond = BI->isConditional() ? BI->getCondition() : NULL;
+				else if (SwitchInst *SI = dyn_cast<SwitchInst>(T))
+					cond = SI->getCondition();
+				int c = cond ? Find_Val(cond, fst) : VAL_Not_Found;
+				if (c == VAL_Not_Found)
+					continue;
+				DomTreeNode *stop = PDT.getNode(&B) ? PDT.getNode(&B)->getIDom() : NULL;
+				SmallPtrSet<BasicBlock *, 16> deps;
+				for (BasicBlock *S : successors(&B))
+					for (DomTreeNode *n = PDT.getNode(S); n && n != stop; n = n->getIDom())
+						if (n->getBlock())
+							deps.insert(n->getBlock());
+				if (deps.empty())
+					continue;
+				ctrl_branches++;
+				std::vector<TaintOp> &ops = P.CtrlOps[c];
+				for (BasicBlock &X : *F)
+				{
+					if (!deps.count(&X))
+						continue;
+					for (Instruction &I : X)
+					{
+						if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+						{
+							int target = Find_Val(SI->getPointerOperand(), fst);
+							if (target == VAL_Not_Found)
+								target = Find_Const_Root(SI->getPointerOperand(), fst);
+							if (target != VAL_Not_Found)
+								ops.push_back({OP_CTRL_STORE, target, VAL_Not_Found});
+							P.CtrlStored.insert(getUnderlyingObject(SI->getPointerOperand()));
+							continue;
+						}
+						int self = Find_Val(&I, fst);
+						if (self != VAL_Not_Found && self != c && !isa<AllocaInst>(&I))
+							ops.push_back({OP_CTRL, self, VAL_Not_Found});
+					}
+				}
+				ctrl_edges += ops.size();
+			}
+		}
+
+		// 切片：在槽位依赖图上求污点源（参数、全局变量、调用点、会被规范化的指针）的前向切片与
+		// 汇点（条件分支、返回值、参数、全局变量、调用实参）的反向切片，两次遍历均与微操作数成线性。
+		// 依赖图的边由各微操作读写的槽位得到（含store/load的反向流），调用点与全局变量各用一个虚结点汇总。
+		// 前向切片之外的槽位始终保持初值，反向切片之外的槽位不影响汇点，因此只保留写入交集内槽位的微操作；
+		// 被切除槽位在输出的帧中保持登记时的类型
+		void Slice_Program(Function *F, funvalst *fst, TaintProgram &P)
+		{
+			int n = fst->functionval_num;
+			int calls = P.Calls.size();
+			int glo = n + calls;	// 全局变量的汇总结点，n..n+calls-1为各调用点
+			int num = glo + 1;
+			std::vector<std::pair<int, int>> edges;
+			BitVector fwd(num), bwd(num);
+			std::vector<int> fwd_work, bwd_work;
+			auto source = [&](int k) { if (k != VAL_Not_Found && !fwd.test(k)) { fwd.set(k); fwd_work.push_back(k); } };
+			auto sink = [&](int k) { if (k != VAL_Not_Found && !bwd.test(k)) { bwd.set(k); bwd_work.push_back(k); } };
+			auto edge = [&](int from, int to) { if (from != VAL_Not_Found && to != VAL_Not_Found) edges.push_back({from, to}); };
+
+			for (int i = 0; i < n; i++)
+			{
+				int def = VAL_Not_Found;
+				for (unsigned o = P.OpBegin[i]; o < P.OpBegin[i + 1]; o++)
+				{
+					const TaintOp &op = P.Ops[o];
+					switch (op.Kind)
+					{
+					case OP_USE_LOAD: edge(i, op.A); source(i); break;
+					case OP_USE_STORE: edge(op.B, op.A); edge(op.A, op.B); source(op.A); break;
+					case OP_USE_COPY: case OP_CTRL: case OP_CTRL_STORE: edge(i, op.A); break;
+					case OP_PTR: source(i); break;
+					case OP_RET: sink(op.A); break;
+					case OP_DEF: def = op.A; break;
+					case OP_DEF_OPND: edge(def, op.A); edge(i, op.A); break;
+					case OP_LOAD_OPND: edge(op.A, op.B); break;
+					case OP_MEM_DEF: edge(op.B, op.A); break;
+					case OP_LOAD_ROOT: edge(op.A, op.B); edge(op.B, op.A); break;
+					}
+				}
+			}
+			// 调用点读写全部实参与全局变量，并写入调用结果
+			for (int c = 0; c < calls; c++)
+			{
+				Instruction *Inst = P.Calls[c];
+				for (Value *op : Inst->operands())
+				{
+					int k = Find_Val(op, fst);
+					edge(k, n + c);
+					edge(n + c, k);
+					sink(k);
+				}
+				edge(n + c, Find_Val(Inst, fst));
+				edge(glo, n + c);
+				edge(n + c, glo);
+				source(n + c);
+				sink(n + c);
+			}
+			for (int g = fst->FunInstVal.GloBegin; g < fst->FunInstVal.GloEnd; g++)
+			{
+				edge(g, glo);
+				edge(glo, g);
+			}
+			source(glo);
+			sink(glo);
+			for (int k = 0; k < fst->FunInstVal.GloEnd; k++)
+			{
+				source(k);
+				sink(k);
+			}
+			for (Instruction &I : instructions(F))
+				if (BranchInst *BI = dyn_cast<BranchInst>(&I))
+					if (BI->isConditional())
+						sink(Find_Val(BI->getCondition(), fst));
+
+			// 按起点/终点计数排序得到前驱与后继的CSR
+			std::vector<unsigned> succ_begin(num + 1, 0), pred_begin(num + 1, 0);
+			std::vector<int> succ(edges.size()), pred(edges.size());
+			for (auto &e : edges)
+			{
+				succ_begin[e.first + 1]++;
+				pred_begin[e.second + 1]++;
+			}
+			for (int k = 0; k < num; k++)
+			{
+				succ_begin[k + 1] += succ_begin[k];
+				pred_begin[k + 1] += pred_begin[k];
+			}
+			std::vector<unsigned> succ_pos(succ_begin.begin(), succ_begin.end() - 1), pred_pos(pred_begin.begin(), pred_begin.end() - 1);
+			for (auto &e : edges)
+			{
+				succ[succ_pos[e.first]++] = e.second;
+				pred[pred_pos[e.second]++] = e.first;
+			}
+			while (!fwd_work.empty())
+			{
+				int k = fwd_work.back();
+				fwd_work.pop_back();
+				for (unsigned s = succ_begin[k]; s < succ_begin[k + 1]; s++)
+					source(succ[s]);
+			}
+			while (!bwd_work.empty())
+			{
+				int k = bwd_work.back();
+				bwd_work.pop_back();
+				for (unsigned s = pred_begin[k]; s < pred_begin[k + 1]; s++)
+					sink(pred[s]);
+			}
+			BitVector &live = fwd;
+			live &= bwd;
+
+			// 只保留写入切片内槽位的微操作；OP_DEF只在其后仍有OP_DEF_OPND时保留
+			std::vector<TaintOp> ops;
+			std::vector<unsigned> op_begin;
+			op_begin.push_back(0);
+			for (int i = 0; i < n; i++)
+			{
+				for (unsigned o = P.OpBegin[i]; o < P.OpBegin[i + 1]; o++)
+				{
+					const TaintOp &op = P.Ops[o];
+					bool keep;
+					switch (op.Kind)
+					{
+					case OP_USE_LOAD: keep = live.test(i) || live.test(op.A); break;
+					case OP_LOAD_ROOT: keep = live.test(op.A) || live.test(op.B); break;
+					case OP_USE_STORE: keep = live.test(op.A) || (op.B != VAL_Not_Found && live.test(op.B)); break;
+					case OP_PTR: keep = live.test(i); break;
+					case OP_RET: case OP_DEF: keep = true; break;
+					case OP_LOAD_OPND: keep = live.test(op.B); break;
+					default: keep = live.test(op.A); break;
+					}
+					if (!keep)
+						continue;
+					if (op.Kind != OP_DEF_OPND && ops.size() > op_begin.back() && ops.back().Kind == OP_DEF)
+						ops.pop_back();
+					ops.push_back(op);
+				}
+				if (ops.size() > op_begin.back() && ops.back().Kind == OP_DEF)
+					ops.pop_back();
+				op_begin.push_back(ops.size());
+			}
+			// 依赖表只登记仍有微操作的槽位
+			std::vector<int> deps;
+			std::vector<unsigned> dep_begin;
+			dep_begin.push_back(0);
+			for (int i = 0; i < n; i++)
+			{
+				for (unsigned d = P.DepBegin[i]; d < P.DepBegin[i + 1]; d++)
+					if (op_begin[P.Deps[d]] != op_begin[P.Deps[d] + 1])
+						deps.push_back(P.Deps[d]);
+				dep_begin.push_back(deps.size());
+			}
+			P.Ops.swap(ops);
+			P.OpBegin.swap(op_begin);
+			P.Deps.swap(deps);
+			P.DepBegin.swap(dep_begin);
+			P.Sliced = true;
+
+			int total = n - fst->FunInstVal.GloEnd, pruned = 0;
+			for (int k = fst->FunInstVal.GloEnd; k < n; k++)
+				if (!live.test(k))
+					pruned++;
+			slice_pruned[F] = std::make_pair(pruned, total);
+		}
+
+		// 按模块中的函数顺序输出各函数（不含声明）被切除的指令槽位比例
+		void Print_Slice(Module &M)
+		{
+			int pruned = 0, total = 0, funcs = 0;
+			for (Function &F : M)
+			{
+				auto it = slice_pruned.find(&F);
+				if (it == slice_pruned.end() || !it->second.second)
+					continue;
+				funcs++;
+				pruned += it->second.first;
+				total += it->second.second;
+				errs() << "slice " << F.getName() << ": pruned " << it->second.first << " of " << it->second.second
+					   << " instructions (" << format("%.1f", it->second.second ? 100.0 * it->second.first / it->second.second : 0.0) << "%)\n";
+			}
+			errs() << "slice: pruned " << pruned << " of " << total << " instructions in " << funcs << " functions ("
+				   << format("%.1f", total ? 100.0 * pruned / total : 0.0) << "%)\n";
+		}
+
+		// 降低F：收集有被调函数的调用点，再逐个槽位生成传递函数和依赖表
+		const TaintProgram &Lower_Function(Function *F, funvalst *fst)
+		{
+			std::unique_ptr<TaintProgram> &prog = programs[F];
+			if (prog)
+				return *prog;
+			auto start = std::chrono::steady_clock::now();
+			prog.reset(new TaintProgram());
+			TaintProgram &P = *prog;
+			P.SelfCall = false;
+			P.Sliced = false;
+			for (Instruction &I : instructions(F))
+			{
+				if (I.getOpcode() != llvm::Instruction::Call)
+					continue;
+				bool call = false;
+				For_Callees(&I, [&](Function *callee) {
+					call = true;
+					if (callee == F)
+						P.SelfCall = true;
+				});
+				call |= shim && Shim_Source(shim->Api(&I));
+				if (!call)
+					continue;
+				P.CallIndex[&I] = P.Calls.size();
+				P.Calls.push_back(&I);
+			}
+			if (StainImplicit)
+				Ctrl_Resolve(F, fst, P);
+			if (StainMSSA)
+				Mem_Resolve(F, fst, P);
+			P.OpBegin.push_back(0);
+			P.DepBegin.push_back(0);
+			P.CallDepBegin.push_back(0);
+			for (int i = 0; i < fst->functionval_num; i++)
+			{
+				Lower_Slot(fst, i, P);
+				P.OpBegin.push_back(P.Ops.size());
+				Dep_Collect(i, fst, P);
+				auto dep = P.Deps.begin() + P.DepBegin.back();
+				std::sort(dep, P.Deps.end());
+				P.Deps.erase(std::unique(dep, P.Deps.end()), P.Deps.end());
+				P.DepBegin.push_back(P.Deps.size());
+				auto cdep = P.CallDeps.begin() + P.CallDepBegin.back();
+				std::sort(cdep, P.CallDeps.end());
+				P.CallDeps.erase(std::unique(cdep, P.CallDeps.end()), P.CallDeps.end());
+				P.CallDepBegin.push_back(P.CallDeps.size());
+			}
+			// 自递归调用的被调帧与本帧共享全部槽位，任何槽位都可能经调用影响汇点，不做裁剪
+			if (StainSlice && !P.SelfCall)
+				Slice_Program(F, fst, P);
+			P.CallIndex.clear();
+			P.MemTracked.clear();
+			P.MemDefs.clear();
+			P.MemUsers.clear();
+			P.CtrlOps.clear();
+			P.CtrlStored.clear();
+			lowered_funcs++;
+			lowered_ops += P.Ops.size();
+			lower_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			return P;
+		}
+
+		// 标记槽位k的变化：按降低时收集的依赖表登记需要重新计算的槽位和调用点
+		void Mark_Dirty(int k, funvalst *fst)
+		{
+			const TaintProgram &P = *fst->Prog;
+			fst->SlotDirty.set(k);
+			for (unsigned d = P.DepBegin[k]; d < P.DepBegin[k + 1]; d++)
+				fst->SlotDirty.set(P.Deps[d]);
+			for (unsigned d = P.CallDepBegin[k]; d < P.CallDepBegin[k + 1]; d++)
+				fst->CallDirty.set(P.CallDeps[d]);
+			// 全局变量对所有被调函数可见；递归调用时被调帧与本帧共享全部值
+			if (P.SelfCall || (k >= fst->functionarg_num && k < fst->functionarg_num + fst->functionglo_num))
+				fst->CallDirty.set();
+		}
+
+		// 写入槽位idx的污点类型，值发生变化时登记依赖它的传递函数
+		void Set_Type(funvalst *fst, int idx, unsigned char type)
+		{
+			if (fst->FunInstVal[idx] == type)
+				return;
+			fst->FunInstVal[idx] = type;
+			if (idx >= fst->FunInstVal.GloBegin && idx < fst->FunInstVal.GloEnd)
+				Stamp_Global(idx - fst->FunInstVal.GloBegin);
+			Mark_Dirty(idx, fst);
+		}
+
+		static bool Is_Tainted(unsigned char type)
+		{
+			return type == State || type == G_ROM_S;
+		}
+
+		// 把来源标签集合lab并入槽位idx；集合变大时与污点类型变化一样登记依赖，返回是否变大
+		int Join_Label(funvalst *fst, int idx, LabelSet lab)
+		{
+			LabelSet cur = fst->Labels[idx];
+			LabelSet u = sets->Union(cur, lab);
+			if (u == cur)
+				return 0;
+			fst->Labels[idx] = u;
+			if (idx >= fst->Labels.GloBegin && idx < fst->Labels.GloEnd)
+				Stamp_Global(idx - fst->Labels.GloBegin);
+			Mark_Dirty(idx, fst);
+			return 1;
+		}
+
+		// 稀疏不动点：每轮按序号顺序只计算被标记的槽位，再按指令顺序分析被标记的调用点。
+		// 轮内新标记的、序号更大的工作单元在本轮继续处理，因此求值顺序与逐轮全量扫描一致；
+		// 与原实现相同，一轮中没有计数的变化即终止
+		void Propagate(Function *F, funvalst *fst)
+		{
+			int change;
+			fst->Prog = &Lower_Function(F, fst);
+			const std::vector<Instruction *> &calls = fst->Prog->Calls;
+			fst->SlotDirty.clear();
+			fst->SlotDirty.resize(fst->functionval_num, !fst->Prog->Sliced);
+			if (fst->Prog->Sliced)
+				for (int i = 0; i < fst->functionval_num; i++)
+					if (fst->Prog->OpBegin[i] != fst->Prog->OpBegin[i + 1])
+						fst->SlotDirty.set(i);
+			fst->CallDirty.clear();
+			fst->CallDirty.resize(calls.size(), true);
+			// 预算每BUDGET_CHECK次求值及达到-stain-budget-evals时检查，每轮结束时再检查一次
+			auto start = std::chrono::steady_clock::now();
+			unsigned long evals = 0, counted = 0;
+			unsigned over = budget ? Over_Budget(fst, start, evals, counted) : 0;
+			while (!over)
+			{
+				if (print_flg)
+					errs() << "Function " << F->getName() << '\n';
+				change = 0;
+				for (int i = fst->SlotDirty.find_first(); i != -1 && !over; i = fst->SlotDirty.find_next(i))
+				{
+					fst->SlotDirty.reset(i);
+					change += Update_Val(fst, i);
+					val_evals++;
+					if (budget && (++evals % BUDGET_CHECK == 0 || evals == StainBudgetEvals))
+						over = Over_Budget(fst, start, evals, counted);
+				}
+				for (int c = fst->CallDirty.find_first(); c != -1 && !over; c = fst->CallDirty.find_next(c))
+				{
+					fst->CallDirty.reset(c);
+					change += Update_Call(fst, calls[c]);
+					call_evals++;
+					if (budget && (++evals % BUDGET_CHECK == 0 || evals == StainBudgetEvals))
+						over = Over_Budget(fst, start, evals, counted);
+				}
+				if (change == 0)
+					break;
+				if (budget && !over)
+					over = Over_Budget(fst, start, evals, counted);
+			}
+			if (over)
+				Widen(F, fst, over);
+		}
+
+		// 检查本次分析（自start起已做evals次求值）与模块的预算，返回耗尽的预算（BUDGET_*）
+		// 调用链上各帧占用的分配区与求值次数、耗时在同一检查点检查
+		unsigned Over_Budget(funvalst *fst, std::chrono::steady_clock::time_point start, unsigned long evals, unsigned long &counted)
+		{
+			unsigned over = 0;
+			unsigned long module_evals = budget->Evals += evals - counted;
+			counted = evals;
+			auto now = std::chrono::steady_clock::now();
+			if (StainBudgetEvals && evals >= StainBudgetEvals)
+				over |= BUDGET_EVALS;
+			if (StainBudgetMs && now - start >= std::chrono::milliseconds(StainBudgetMs))
+				over |= BUDGET_TIME;
+			if (StainBudgetKB && arena.Used(fst->ArenaTop) > StainBudgetKB * 1024UL)
+				over |= BUDGET_MEMORY;
+			if ((StainModuleBudgetEvals && module_evals >= StainModuleBudgetEvals) ||
+				(StainModuleBudgetMs && now - budget->Start >= std::chrono::milliseconds(StainModuleBudgetMs)))
+				budget->Exhausted = true;
+			if (budget->Exhausted)
+				over |= BUDGET_MODULE;
+			return over;
+		}
+
+		// 预算耗尽时把F的结果放宽为全部污染：帧中除全局变量外的槽位、F及其被调函数引用的全局变量和返回值，
+		// -stain-labels下标签放宽为全部来源种类。放宽只会增加污点，调用者据此合并的结果仍是安全的
+		void Widen(Function *F, funvalst *fst, unsigned over)
+		{
+			LabelSet all = LABEL_SET_EMPTY;
+			if (labels)
+			{
+				for (int l = 0; l < LABEL_KINDS; l++)
+					all = sets->Union(all, sets->Site(1 << l, NULL));
+				if (scc)
+					all = sets->Union(all, sets->Site(LABEL_SEED, NULL));
+			}
+			for (int k = 0; k < fst->functionval_num; k++)
+			{
+				if (k >= fst->FunInstVal.GloBegin && k < fst->FunInstVal.GloEnd)
+					continue;
+				Set_Type(fst, k, Seed_Type(fst->FunInst[k], true));
+				if (labels)
+					Join_Label(fst, k, all);
+			}
+			for (GlobalVariable *g : Find_Relevant_Global(F))
+			{
+				int k = Find_Val(g, fst);
+				if (k == VAL_Not_Found)
+					continue;
+				Set_Type(fst, k, G_ROM_S);
+				if (labels)
+					Join_Label(fst, k, all);
+			}
+			if (!F->getReturnType()->isVoidTy())
+			{
+				fst->RetType = F->getReturnType()->isPointerTy() ? G_ROM_S : State;
+				if (labels)
+					fst->RetLabels = sets->Union(fst->RetLabels, all);
+			}
+			fst->SlotDirty.reset();
+			fst->CallDirty.reset();
+			BudgetHit &hit = budget_hits[F];
+			hit.Count++;
+			hit.Reasons |= over;
+		}
+
+		// 按模块中的函数顺序输出耗尽预算而被放宽的函数
+		void Print_Budget(Module &M)
+		{
+			unsigned funcs = 0, widened = 0;
+			for (Function &F : M)
+			{
+				auto it = budget_hits.find(&F);
+				if (it == budget_hits.end())
+					continue;
+				funcs++;
+				widened += it->second.Count;
+				errs() << "budget " << F.getName() << ": widened " << it->second.Count << " times (";
+				const char *sep = "";
+				for (unsigned r = 0; r < array_lengthof(Budget_Names); r++)
+					if (it->second.Reasons & (1 << r))
+					{
+						errs() << sep << Budget_Names[r];
+						sep = ", ";
+					}
+				errs() << ")\n";
+			}
+			errs() << "budget: " << funcs << " functions widened " << widened << " times, module " << budget->Evals << " evals in "
+				   << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - budget->Start).count()
+				   << " ms" << (budget->Exhausted ? ", module budget exhausted" : "") << "\n";
+		}
+
+		// 槽位i的传递函数：依次执行降低得到的微操作
+		int Update_Val(funvalst *fst, int i)
+		{
+			const TaintProgram &P = *fst->Prog;
+			SlotTypes &val = fst->FunInstVal;
+			SlotLabels &lab = fst->Labels;
+			int change = 0;
+			bool def_active = false;
+
+			for (unsigned o = P.OpBegin[i]; o < P.OpBegin[i + 1]; o++)
+			{
+				const TaintOp &op = P.Ops[o];
+				switch (op.Kind)
+				{
+				// load指令，如果当前指令i是污点，那么所有使用者是污点
+				case OP_USE_LOAD:
+					// 如果i是load的指针参数
+					if (val[i] == G_ROM_S)
+					{
+						if (val[op.A] == No_state)
+						{
+							Set_Type(fst, op.A, State);
+							change++;
+						}
+						else if (val[op.A] == G_ROM_N)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+					}
+					// 如果i是load的值参数，则被认为和内存污染情况相关
+					else if (val[i] == State)
+					{
+						Set_Type(fst, i, G_ROM_S);
+						change++;
+					}
+					else if (val[i] == No_state)
+					{
+						Set_Type(fst, i, G_ROM_N);
+						change++;
+					}
+					// 标签沿污点的方向传播：被污染的槽位把标签并入它污染的槽位
+					if (labels && val[i] == G_ROM_S)
+						change += Join_Label(fst, op.A, lab[i]);
+					break;
+				// store指令，如果当前指令i是污点，那么所有使用者是污点
+				case OP_USE_STORE:
+					if (op.B != VAL_Not_Found && (val[op.B] == G_ROM_S || val[op.B] == State))
+					{
+						if (val[op.A] != G_ROM_S)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+					}
+					else if (val[op.A] == State)
+					{
+						if (print_flg)
+							errs() << " change type store\n";
+						Set_Type(fst, op.A, G_ROM_S);
+						change++;
+					}
+					else if (val[op.A] == No_state)
+					{
+						if (print_flg)
+							errs() << " change type store\n";
+						Set_Type(fst, op.A, G_ROM_N);
+						change++;
+					}
+
+					if (val[op.A] == G_ROM_S && op.B != VAL_Not_Found && val[op.B] == G_ROM_N)
+						Set_Type(fst, op.B, G_ROM_S);
+					if (labels && op.B != VAL_Not_Found)
+					{
+						if (Is_Tainted(val[op.B]))
+							change += Join_Label(fst, op.A, lab[op.B]);
+						if (val[op.A] == G_ROM_S && val[op.B] == G_ROM_S)
+							change += Join_Label(fst, op.B, lab[op.A]);
+					}
+					break;
+				case OP_USE_COPY:
+					if (val[op.A] == No_state)
+					{
+						if (val[op.A] != val[i])
+						{
+							Set_Type(fst, op.A, val[i]);
+							change++;
+						}
+					}
+					else if (val[op.A] == G_ROM_N)
+					{
+						if (val[i] == G_ROM_S || val[i] == State)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+					}
+					if (labels && Is_Tainted(val[i]))
+						change += Join_Label(fst, op.A, lab[i]);
+					break;
+				case OP_PTR:
+					if (val[i] == State)
+					{
+						Set_Type(fst, i, G_ROM_S);
+						change++;
+					}
+					if (val[i] == No_state)
+					{
+						Set_Type(fst, i, G_ROM_N);
+						change++;
+					}
+					break;
+				case OP_RET:
+					if (fst->RetType != G_ROM_S && fst->RetType != State)
+						fst->RetType = op.A != VAL_Not_Found ? (unsigned char)val[op.A] : (unsigned char)VAL_Not_Found;
+					if (labels && op.A != VAL_Not_Found && Is_Tainted(val[op.A]))
+						fst->RetLabels = sets->Union(fst->RetLabels, lab[op.A]);
+					break;
+				case OP_DEF:
+					def_active = val[op.A] == G_ROM_S;
+					break;
+				case OP_DEF_OPND:
+					if (def_active && val[op.A] == G_ROM_N)
+					{
+						Set_Type(fst, op.A, G_ROM_S);
+						change++;
+					}
+					if (labels && def_active && val[op.A] == G_ROM_S)
+						change += Join_Label(fst, op.A, lab[i]);
+					break;
+				case OP_LOAD_OPND:
+					if (val[op.B] == G_ROM_N && (val[op.A] == G_ROM_S || val[op.A] == State))
+					{
+						Set_Type(fst, op.B, G_ROM_S);
+						change++;
+					}
+					if (labels && Is_Tainted(val[op.A]) && val[op.B] == G_ROM_S)
+						change += Join_Label(fst, op.B, lab[op.A]);
+					break;
+				case OP_MEM_DEF:
+					if (Is_Tainted(val[op.B]))
+					{
+						if (val[op.A] == No_state)
+						{
+							Set_Type(fst, op.A, State);
+							change++;
+						}
+						else if (val[op.A] == G_ROM_N)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+						if (labels)
+							change += Join_Label(fst, op.A, lab[op.B]);
+					}
+					break;
+				case OP_CTRL:
+					if (Is_Tainted(val[i]))
+					{
+						if (val[op.A] == No_state)
+						{
+							Set_Type(fst, op.A, State);
+							change++;
+						}
+						else if (val[op.A] == G_ROM_N)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+						if (labels)
+							change += Join_Label(fst, op.A, lab[i]);
+					}
+					break;
+				case OP_CTRL_STORE:
+					if (Is_Tainted(val[i]))
+					{
+						if (val[op.A] != G_ROM_S)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+						if (labels)
+							change += Join_Label(fst, op.A, lab[i]);
+					}
+					break;
+				case OP_LOAD_ROOT:
+					if (val[op.B] == G_ROM_S)
+					{
+						if (val[op.A] == No_state)
+						{
+							Set_Type(fst, op.A, State);
+							change++;
+						}
+						else if (val[op.A] == G_ROM_N)
+						{
+							Set_Type(fst, op.A, G_ROM_S);
+							change++;
+						}
+					}
+					else
+					{
+						if (val[op.A] == State || val[op.A] == G_ROM_S)
+						{
+							Set_Type(fst, op.B, G_ROM_S);
+							change++;
+						}
+					}
+					// 根全局变量与读出的值都被污染时两者标签相同
+					if (labels && val[op.B] == G_ROM_S && Is_Tainted(val[op.A]))
+					{
+						change += Join_Label(fst, op.A, lab[op.B]);
+						change += Join_Label(fst, op.B, lab[op.A]);
+					}
+					break;
+				}
+			}
+			return change;
+		}
+
+		// 收集F及其调用链（直接调用，及-stain-icall下间接调用的候选）上所有函数中引用的全局变量（含常量表达式中的引用）
+		// 被调函数的分析结果只依赖这些全局变量的污点，其余全局变量在被调帧中只会被规范化为指针类型
+		std::vector<GlobalVariable *> &Find_Relevant_Global(Function *F)
+		{
+			auto it = relevant_glo.find(F);
+			if (it != relevant_glo.end())
+				return it->second;
+			std::vector<GlobalVariable *> &globals = relevant_glo[F];
+			SmallPtrSet<Function *, 16> funs;
+			SmallPtrSet<Constant *, 32> seen;
+			SmallVector<Function *, 16> stack;
+			funs.insert(F);
+			stack.push_back(F);
+			while (!stack.empty())
+			{
+				Function *f = stack.pop_back_val();
+				for (Instruction &I : instructions(f))
+				{
+					for (Value *op : I.operands())
+					{
+						SmallVector<Constant *, 4> cs;
+						if (Constant *C = dyn_cast<Constant>(op))
+							cs.push_back(C);
+						while (!cs.empty())
+						{
+							Constant *C = cs.pop_back_val();
+							if (!seen.insert(C).second)
+								continue;
+							if (GlobalVariable *g = dyn_cast<GlobalVariable>(C))
+								globals.push_back(g);
+							else if (isa<ConstantExpr>(C))
+								for (Value *cop : C->operands())
+									cs.push_back(cast<Constant>(cop));
+						}
+					}
+					if (I.getOpcode() == llvm::Instruction::Call)
+						For_Callees(&I, [&](Function *callee) {
+							if (funs.insert(callee).second)
+								stack.push_back(callee);
+						});
+				}
+			}
+			return globals;
+		}
+
+		// 被调函数的输入上下文：调用深度、实参污点类型和相关全局变量的污点类型
+		std::string Summary_Key(Function *subf, funvalst *fst, Instruction *Inst)
+		{
+			std::string key;
+			key.push_back((char)subdeep);
+			for (unsigned jj = 0; jj < subf->arg_size(); jj++)
+			{
+				int k = Find_Val(Inst->getOperand(jj), fst);
+				key.push_back(k != VAL_Not_Found ? fst->FunInstVal[k] : No_state);
+			}
+			for (GlobalVariable *g : Find_Relevant_Global(subf))
+				key.push_back(Find_Val_Type(g, fst));
+			// 来源标签也是输入上下文的一部分
+			if (labels)
+			{
+				for (unsigned jj = 0; jj < subf->arg_size(); jj++)
+				{
+					int k = Find_Val(Inst->getOperand(jj), fst);
+					LabelSet l = k != VAL_Not_Found ? fst->Labels[k] : LABEL_SET_EMPTY;
+					key.append((const char *)&l, sizeof(l));
+				}
+				for (GlobalVariable *g : Find_Relevant_Global(subf))
+				{
+					LabelSet l = fst->Labels[Find_Val(g, fst)];
+					key.append((const char *)&l, sizeof(l));
+				}
+			}
+			return key;
 		}
 
-		// 找出指定value在functionval_num中的序号
-		int Find_Val(Value *v, funvalst *fst)
+		// 从分析完成的被调帧subfst中提取摘要；被调函数改写的全局变量取自写入记录中mark之后的部分
+		void Record_Summary(funvalst *subfst, size_t mark, TaintSummary *sum)
 		{
-			int i;
-			for (i = 0; i < fst->functionval_num; i++)
+			sum->RetType = subfst->RetType;
+			sum->RetLabels = subfst->RetLabels;
+			sum->ArgType.clear();
+			sum->ArgLabels.clear();
+			for (int jj = 0; jj < subfst->functionarg_num; jj++)
 			{
-				if (fst->FunInst[i] == v)
-					return i;
+				sum->ArgType.push_back(subfst->FunInstVal[jj]);
+				sum->ArgLabels.push_back(subfst->Labels[jj]);
 			}
-			return -1;
+			For_Global_Writes(mark, [&](int g) {
+				sum->GloWrite.push_back({gt.Vars[g], Taint_Get(gt.Type.data(), g)});
+				sum->GloLabels.push_back(gt.Labels[g]);
+			});
 		}
 
-		// 找出指定value的污点类型
-		unsigned char Find_Val_Type(Value *u, funvalst *fst)
+		// 把摘要合并回调用者帧，合并规则与完整分析后的合并相同
+		int Apply_Summary(funvalst *fst, Instruction *Inst, TaintSummary &sum)
 		{
-			int i;
-			for (i = 0; i < fst->functionval_num; i++)
+			int change = 0;
+			int k = Find_Val(Inst, fst);
+			if (k != VAL_Not_Found && fst->FunInstVal[k] == No_state && sum.RetType != No_state)
 			{
-				if (fst->FunInst[i] == u)
-					return fst->FunInstVal[i];
+				Set_Type(fst, k, sum.RetType);
+				change++;
 			}
-			return VAL_Not_Found;
+			if (labels && k != VAL_Not_Found && Is_Tainted(sum.RetType))
+				change += Join_Label(fst, k, sum.RetLabels);
+			for (unsigned w = 0; w < sum.GloWrite.size(); w++)
+			{
+				k = Find_Val(sum.GloWrite[w].first, fst);
+				if (fst->FunInstVal[k] != sum.GloWrite[w].second)
+				{
+					Set_Type(fst, k, sum.GloWrite[w].second);
+					change++;
+				}
+				if (labels)
+					change += Join_Label(fst, k, sum.GloLabels[w]);
+			}
+			for (unsigned jj = 0; jj < sum.ArgType.size(); jj++)
+			{
+				k = Find_Val(Inst->getOperand(jj), fst);
+				if (k != VAL_Not_Found && sum.ArgType[jj] == G_ROM_S && fst->FunInstVal[k] == G_ROM_N)
+				{
+					Set_Type(fst, k, G_ROM_S);
+					change++;
+				}
+				if (labels && k != VAL_Not_Found && sum.ArgType[jj] == G_ROM_S)
+					change += Join_Label(fst, k, sum.ArgLabels[jj]);
+			}
+			return change;
 		}
 
-		// 遍历函数参数，污染了一个指针类型的参数变量
-		void Find_All_FunctionArg(Function *F, funvalst *fst)
+		// 标签来源的调用点：返回值和输出参数被污染，标签模式下并带上标签label，被调函数（通常只有声明）不再分析
+		int Apply_Label_Source(funvalst *fst, Instruction *Inst, TaintLabels label, unsigned char out)
 		{
-			Argument *arg;
-			unsigned int l;
-			//find all of the global variable
-			for (Function::arg_iterator i = F->arg_begin(), e = F->arg_end(); i != e; ++i)
+			int change = 0;
+			CallBase *CB = cast<CallBase>(Inst);
+			SmallVector<Value *, 4> outs;
+			outs.push_back(Inst);
+			for (unsigned jj = 0; jj < CB->arg_size(); jj++)
+				if (CB->paramHasAttr(jj, Attribute::StructRet) || (out == LABEL_OUT_LAST && jj + 1 == CB->arg_size()))
+					outs.push_back(CB->getArgOperand(jj));
+			for (Value *v : outs)
 			{
-				arg = &*i;
-				fst->FunInst[fst->functionval_num] = arg;
-				if (i->getType()->getTypeID() != Type::PointerTyID)
-					fst->FunInstVal[fst->functionval_num] = State;
-				else
-					fst->FunInstVal[fst->functionval_num] = State; //which don't know the data struct
-				if (print_flg)
-					errs() << "arg: %" << fst->functionval_num << "\n";
-				fst->functionval_num++;
+				int k = Find_Val(v, fst);
+				if (k == VAL_Not_Found)
+					continue;
+				if (!Is_Tainted(fst->FunInstVal[k]))
+				{
+					Set_Type(fst, k, Seed_Type(v, true));
+					change++;
+				}
+				if (labels)
+					change += Join_Label(fst, k, sets->Site(label, Inst));
 			}
-			fst->functionarg_num = fst->functionval_num;
-			if (print_flg)
-				errs() << "------------------------------------------\n";
+			return change;
 		}
 
-		void Print_Type(int i)
+		// memcpy/memmove的传递函数：源指针被污染时目的指针也被污染，标签模式下并带上源的标签
+		// gollvm把sret输出逐字段memcpy到局部变量，shim取数API的结果只有经过这一步才能到达分支
+		int Apply_Mem_Transfer(funvalst *fst, MemTransferInst *MT)
 		{
-			if (i == No_state)
-				errs() << "NS";
-			else if (i == G_ROM_N)
-				errs() << "GRN";
-			else if (i == G_ROM_S)
-				errs() << "GRS";
-			else if (i == State)
-				errs() << "ST";
+			int src = Find_Val(MT->getRawSource(), fst), dst = Find_Val(MT->getRawDest(), fst);
+			if (src == VAL_Not_Found || dst == VAL_Not_Found || fst->FunInstVal[src] != G_ROM_S)
+				return 0;
+			int change = 0;
+			if (fst->FunInstVal[dst] != G_ROM_S)
+			{
+				Set_Type(fst, dst, G_ROM_S);
+				change++;
+			}
+			if (labels)
+				change += Join_Label(fst, dst, fst->Labels[src]);
+			return change;
 		}
 
-		// 输出函数内所有指令及污点类型
-		void Print_Function(Function *F, funvalst *fst)
+		// 调用点Inst的传递函数：shim取数API为污点源，间接调用点依次分析各候选被调函数，结果合并回fst
+		int Update_Call(funvalst *fst, Instruction *Inst)
 		{
-			unsigned int br_num, op_num, rom_num;
-			br_num = op_num = rom_num = 0;
-			errs() << "Function " << F->getName() << '\n';
-			BasicBlock *BB_c;
-			int j;
-			// functionarg按照参数，全局，局部变量的顺序计数
-			errs() << "arg\n";
-			for (int valindex = 0; valindex < fst->functionarg_num; valindex++)
+			int change = 0;
+			unsigned char out;
+			if (shim)
+				if (TaintLabels label = shim->Source(cast<CallBase>(Inst), NULL, out))
+					return Apply_Label_Source(fst, Inst, label, out);
+			if (MemTransferInst *MT = dyn_cast<MemTransferInst>(Inst))
+				change += Apply_Mem_Transfer(fst, MT);
+			For_Callees(Inst, [&](Function *subf) { change += Update_Callee(fst, Inst, subf); });
+			return change;
+		}
+
+		// 调用点Inst调用subf时的传递函数：在子帧中分析被调函数，再将返回值、全局变量和参数的污点合并回fst
+		int Update_Callee(funvalst *fst, Instruction *Inst, Function *subf)
+		{
+			int change = 0;
+			unsigned char ret_type, out;
+			TaintSummary *sum = NULL;
+			if (shim)
+				if (TaintLabels label = shim->Source(cast<CallBase>(Inst), subf, out))
+					return Apply_Label_Source(fst, Inst, label, out);
+			// 自底向上模式中被调函数的摘要已经算好
+			if (scc)
+				return Apply_Scc_Summary(fst, Inst, subf);
+			// 超过最大调用深度的被调函数不再分析
+			if (subdeep + 1 >= MAX_SUB_FUN_DEEP)
+				return 0;
+			// 自递归调用的被调帧与调用者帧共享指令槽位，不做摘要
+			if (subf != fst->Func)
 			{
-				errs() << "[" << valindex << "]";
-				Print_Type(fst->FunInstVal[valindex]);
-				errs() << "\n";
+				std::string key = Summary_Key(subf, fst, Inst);
+				auto ins = summaries[subf].try_emplace(key);
+				if (!ins.second)
+				{
+					summary_hits++;
+					return Apply_Summary(fst, Inst, ins.first->second);
+				}
+				summary_misses++;
+				sum = &ins.first->second;
 			}
-			errs() << "glo\n";
-			for (int valindex = fst->functionarg_num; valindex < fst->functionglo_num; valindex++)
+			// 被调帧建立在subf的帧布局之上，进入时只写入实参
+			Enter_Frame(&subfst[subdeep], subf, fst);
+			//							errs()<<"$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$\n";
+			//							errs()<<"<< deep >>"<<subdeep<<"\n";
+			//							/*
+			for (int jj = 0; jj < subfst[subdeep].functionarg_num; jj++)
 			{
-				errs() << "[" << valindex << "]";
-				Print_Type(fst->FunInstVal[valindex]);
-				errs() << "\n";
+				if (Find_Val(Inst->getOperand(jj), fst) != VAL_Not_Found)
+				{
+					subfst[subdeep].FunInstVal[jj] = Find_Val_Type(Inst->getOperand(jj), fst);
+					if (labels)
+						subfst[subdeep].Labels[jj] = fst->Labels[Find_Val(Inst->getOperand(jj), fst)];
+				}
+				else
+				{
+					subfst[subdeep].FunInstVal[jj] = No_state;
+				}
 			}
-			errs() << "body\n";
-			for (Function::iterator i = F->begin(), e = F->end(); i != e; ++i)
+			//							*/
+			// 自递归调用时形参也在调用者帧中
+			for (int jj = 0; jj < subfst[subdeep].functionarg_num; jj++)
 			{
-				BB_c = &*i;
-				Instruction *Inst;
-				for (BasicBlock::iterator i2 = BB_c->begin(), e2 = BB_c->end(); i2 != e2; ++i2) 
+				if (Find_Val(subfst[subdeep].FunInst[jj], fst) != VAL_Not_Found)
 				{
-					char block_split = 0;
-					Inst = &*i2;
-					errs() << Inst->getOpcodeName();
-					
-					// 如果是call指令，则输出跳转函数名称（最后一个参数）
-					if (Inst->getOpcode() == llvm::Instruction::Call)
-					{
-						if (dyn_cast<Function>(Inst->getOperand(Inst->getNumOperands() - 1)))
-							errs() << " Function " << Inst->getNumOperands() << " ";
-					}
+					subfst[subdeep].FunInstVal[jj] = Find_Val_Type(subfst[subdeep].FunInst[jj], fst);
+					if (labels)
+						subfst[subdeep].Labels[jj] = fst->Labels[Find_Val(subfst[subdeep].FunInst[jj], fst)];
+				}
+			}
+			// 全局变量污点由调用者和被调函数共享，不再复制
+			size_t log_mark = gt.Log.size();
 
-					// 如果是br指令且指令参数为污点类型，则说明存在风险
-					if (llvm::Instruction::Br == Inst->getOpcode() && 
-						Find_Val(Inst->getOperand(0), fst) != VAL_Not_Found && 
-						((fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == State) || 
-						(fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == G_ROM_S)))
+			subdeep++;
+			if (subdeep < MAX_SUB_FUN_DEEP)
+			{
+				if (Find_Val(Inst, fst) != VAL_Not_Found)
+					ret_type = Find_Val_Type(Inst, fst);
+				Propagate(subf, &subfst[subdeep - 1]);
+				if (print_flg)
+				{
+					errs() << "$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$\n";
+					Print_Function(subf, &subfst[subdeep - 1]);
+					errs() << "$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$\n";
+				}
+				if (sum)
+					Record_Summary(&subfst[subdeep - 1], log_mark, sum);
+				if (Find_Val(Inst, fst) != VAL_Not_Found) //return change
+				{
+					//									fst->FunInstVal[Find_Val(Inst,fst)] = State;
+					if (ret_type == No_state && subfst[subdeep - 1].RetType != No_state)
 					{
-						errs() << " [Br time atack may be! ] <" << br_num << ">";
-						br_num++;
+						Set_Type(fst, Find_Val(Inst, fst), subfst[subdeep - 1].RetType);
+						change++;
 					}
-
-					// 如果是一般指令则输出指令名称和污点类型，以及指令参数（显示为序号）的污点类型
-					// 若指令参数并未被标记为污点或非污点，则显示为常量（CT）
-					if (Find_Val(Inst, fst) != VAL_Not_Found)
+					if (labels && Is_Tainted(subfst[subdeep - 1].RetType))
+						change += Join_Label(fst, Find_Val(Inst, fst), subfst[subdeep - 1].RetLabels);
+				}
+				//global val change：被调函数已直接写入共享表，这里只登记它改过的全局变量
+				For_Global_Writes(log_mark, [&](int g) {
+					Mark_Dirty(fst->FunInstVal.GloBegin + g, fst);
+					change++;
+				});
+				// 自递归调用的被调帧与调用者帧槽位布局相同，其余槽位按序号合并；只处理被调帧写入过的槽位
+				if (subf == fst->Func)
+				{
+					funvalst *callee = &subfst[subdeep - 1];
+					for (int ii : callee->Written)
 					{
-						errs() << " ( " << Find_Val(Inst, fst) << " ";
-						Print_Type((int)fst->FunInstVal[Find_Val(Inst, fst)]);
-						errs() << " " << (int)Inst->getType()->getTypeID() << " ) ";
+						unsigned char type = callee->FunInstVal[ii];
+						if (fst->FunInstVal[ii] != type)
+						{
+							Set_Type(fst, ii, type);
+							change++;
+						}
+						if (labels)
+							change += Join_Label(fst, ii, callee->Labels[ii]);
 					}
-
-					for (int j = 0; j < Inst->getNumOperands(); j++)
+				}
+				///*
+				for (int jj = 0; jj < subfst[subdeep - 1].functionarg_num; jj++) //arg change
+				{
+					if (Find_Val(Inst->getOperand(jj), fst) != VAL_Not_Found)
 					{
-						if (Find_Val(Inst->getOperand(j), fst) != VAL_Not_Found)
+						if (subfst[subdeep - 1].FunInstVal[jj] == G_ROM_S && Find_Val_Type(Inst->getOperand(jj), fst) == G_ROM_N)
 						{
-							errs() << " [ " << Find_Val(Inst->getOperand(j), fst) << " ";
-							Print_Type((int)fst->FunInstVal[Find_Val(Inst->getOperand(j), fst)]);
-							errs() << " ] ";
+							Set_Type(fst, Find_Val(Inst->getOperand(jj), fst), G_ROM_S);
+							change++;
 						}
-						else
-							errs() << " [ CT ] ";
+						if (labels && subfst[subdeep - 1].FunInstVal[jj] == G_ROM_S)
+							change += Join_Label(fst, Find_Val(Inst->getOperand(jj), fst), subfst[subdeep - 1].Labels[jj]);
 					}
-					errs() << "\n";
-					if (block_split == 1)
-						break;
 				}
-				errs() << "block end\n";
+				//*/
 			}
-			errs() << "Function " << F->getName() << " br attack :" << br_num << '\n';
+			subdeep--;
+			// 入口帧之外已没有调用者需要这些写入记录
+			if (fst->Root)
+				gt.Log.clear();
+			return change;
 		}
 
-		int Update_Val(Function *F, funvalst *fst)
+		// 污点类型的合并：No_state为最小元，G_ROM_N与State合并为G_ROM_S
+		static unsigned char Join_Type(unsigned char a, unsigned char b)
 		{
-			int i;
-			int change = 0;
-			Instruction *FInst;
-			ConstantExpr *CE;
-			Value *v;
-			Instruction *Inst;
-			Instruction *SI;
+			return Taint_Type(Taint_Bits(a) | Taint_Bits(b));
+		}
+
+		// 实参/参数的初始污点类型：指针按G_ROM_N/G_ROM_S，其余按No_state/State
+		static unsigned char Seed_Type(Value *v, bool tainted)
+		{
+			if (v->getType()->isPointerTy())
+				return tainted ? G_ROM_S : G_ROM_N;
+			return tainted ? State : No_state;
+		}
+
+		// 自底向上模式的调用点：把各被污染实参对应的摘要与无污染摘要合并，再按完整分析的规则合并回fst
+		int Apply_Scc_Summary(funvalst *fst, Instruction *Inst, Function *subf)
+		{
+			auto it = scc->Summary.find(subf);
+			if (it == scc->Summary.end() || it->second.RetType.empty())
+				return 0;
+			SccSummary &ss = it->second;
+			TaintSummary sum;
+			sum.RetType = ss.RetType[0];
+			sum.ArgType = ss.ArgType[0];
+			sum.RetLabels = ss.RetLabels[0];
+			sum.ArgLabels = ss.ArgLabels[0];
+			for (unsigned jj = 0; jj < subf->arg_size(); jj++)
+			{
+				unsigned char type = Find_Val_Type(Inst->getOperand(jj), fst);
+				if (type != State && type != G_ROM_S)
+					continue;
+				sum.RetType = Join_Type(sum.RetType, ss.RetType[jj + 1]);
+				for (unsigned ii = 0; ii < sum.ArgType.size(); ii++)
+					sum.ArgType[ii] = Join_Type(sum.ArgType[ii], ss.ArgType[jj + 1][ii]);
+				if (!labels)
+					continue;
+				LabelSet arg_lab = fst->Labels[Find_Val(Inst->getOperand(jj), fst)];
+				sum.RetLabels = sets->Union(sum.RetLabels, Seed_Labels(ss.RetLabels[jj + 1], arg_lab));
+				for (unsigned ii = 0; ii < sum.ArgLabels.size(); ii++)
+					sum.ArgLabels[ii] = sets->Union(sum.ArgLabels[ii], Seed_Labels(ss.ArgLabels[jj + 1][ii], arg_lab));
+			}
+			return Apply_Summary(fst, Inst, sum);
+		}
+
+		// 摘要中的LABEL_SEED替换为实参的标签arg_lab
+		LabelSet Seed_Labels(LabelSet lab, LabelSet arg_lab)
+		{
+			if (!(sets->Kind(lab) & LABEL_SEED))
+				return lab;
+			return sets->Union(sets->Strip(lab, LABEL_SEED), arg_lab);
+		}
+
+		// 以第seed个参数为污点源（-1表示无）分析F，全局变量从glo/glo_lab读入，结果合并回glo/glo_lab
+		// 经由实参写入全局变量的标签无法按调用点还原，合并时去掉LABEL_SEED
+		void Scc_Analyse(Function *F, int seed, TaintWords &glo, std::vector<LabelSet> &glo_lab)
+		{
+			Enter_Frame(&mainst, F, NULL);
+			for (int jj = 0; jj < mainst.functionarg_num; jj++)
+			{
+				mainst.FunInstVal[jj] = Seed_Type(mainst.FunInst[jj], jj == seed);
+				if (labels && jj == seed)
+					mainst.Labels[jj] = sets->Site(LABEL_SEED, NULL);
+			}
+			std::copy(glo.begin(), glo.end(), gt.Type.begin());
+			std::copy(glo_lab.begin(), glo_lab.end(), gt.Labels.begin());
+			Propagate(F, &mainst);
+			Taint_Join(glo, gt.Type);
+			if (labels)
+				for (size_t g = 0; g < glo_lab.size(); g++)
+					glo_lab[g] = sets->Union(glo_lab[g], sets->Strip(gt.Labels[g], LABEL_SEED));
+		}
 
-			// 遍历functionval中每一个指令的使用者
-			for (i = 0; i < fst->functionval_num; i++)
+		// 重新计算F的摘要并与已有摘要合并，返回摘要是否变大
+		bool Scc_Summarise(Function *F, SccSummary &ss, TaintWords &glo, std::vector<LabelSet> &glo_lab)
+		{
+			int n = F->arg_size();
+			bool grown = false;
+			if (ss.RetType.empty())
+			{
+				ss.RetType.assign(n + 1, No_state);
+				ss.ArgType.assign(n + 1, std::vector<unsigned char>(n, No_state));
+				ss.RetLabels.assign(n + 1, LABEL_SET_EMPTY);
+				ss.ArgLabels.assign(n + 1, std::vector<LabelSet>(n, LABEL_SET_EMPTY));
+				grown = true;
+			}
+			for (int seed = -1; seed < n; seed++)
 			{
-				v = fst->FunInst[i];
-				for (User *u : fst->FunInst[i]->users())
+				Scc_Analyse(F, seed, glo, glo_lab);
+				unsigned char type = Join_Type(ss.RetType[seed + 1], mainst.RetType);
+				grown |= type != ss.RetType[seed + 1];
+				ss.RetType[seed + 1] = type;
+				LabelSet lab = labels ? sets->Union(ss.RetLabels[seed + 1], mainst.RetLabels) : LABEL_SET_EMPTY;
+				grown |= lab != ss.RetLabels[seed + 1];
+				ss.RetLabels[seed + 1] = lab;
+				for (int jj = 0; jj < n; jj++)
 				{
-					if (Used_to_Inst(u))
-					{
-						Inst = (Instruction *)Used_to_Inst(u);
-						// 这里只处理函数内传播
-						if (Inst->getParent()->getParent() == F)
-						{
-							// load指令，如果当前指令i是污点，那么所有使用者是污点
-							if (Inst->getOpcode() == llvm::Instruction::Load)
-							{
-								if (Find_Val(Inst, fst) != VAL_Not_Found)
-								{
-									// 如果i是load的指针参数
-									if (fst->FunInstVal[i] == G_ROM_S)
-									{
-										if (fst->FunInstVal[Find_Val(Inst, fst)] == No_state)
-										{
-											fst->FunInstVal[Find_Val(Inst, fst)] = State;
-											change++;
-										}
-										else if (fst->FunInstVal[Find_Val(Inst, fst)] == G_ROM_N)
-										{
-											fst->FunInstVal[Find_Val(Inst, fst)] = G_ROM_S;
-											change++;
-										}
-									}
-									// 如果i是load的值参数，则被认为和内存污染情况相关
-									else if (fst->FunInstVal[i] == State)
-									{
-										fst->FunInstVal[i] = G_ROM_S;
-										change++;
-									}
-									else if (fst->FunInstVal[i] == No_state)
-									{
-										fst->FunInstVal[i] = G_ROM_N;
-										change++;
-									}
-								}
-							}
-							// store指令，如果当前指令i是污点，那么所有使用者是污点
-							else if (Inst->getOpcode() == llvm::Instruction::Store)
-							{
-								int target_index = VAL_Not_Found;
-								// 如果是写入已被统计过的指针变量的地址，target_index为对应的序号
-								if (Find_Val(Inst->getOperand(1), fst) != VAL_Not_Found)
-									target_index = Find_Val(Inst->getOperand(1), fst);
-								else
-								{
-									if (dyn_cast<ConstantExpr>(Inst->getOperand(1)))
-									{
-										CE = dyn_cast<ConstantExpr>(Inst->getOperand(1));
-										SI = CE->getAsInstruction();
-										for (int jj = 0; jj < SI->getNumOperands(); jj++)
-										{
-											if (Find_Val(SI->getOperand(jj), fst) != VAL_Not_Found)
-											{
-												target_index = Find_Val(SI->getOperand(jj), fst);
-												break;
-											}
-										}
-										SI->deleteValue();
-									}
-								}
-
-								if (target_index != VAL_Not_Found)
-								{
-									if (Find_Val(Inst->getOperand(0), fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == G_ROM_S)
-									{
-										if (fst->FunInstVal[target_index] != G_ROM_S)
-										{
-											fst->FunInstVal[target_index] = G_ROM_S;
-											//errs()<<"3\n";
-											change++;
-										}
-									}
-									else if (Find_Val(Inst->getOperand(0), fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == State)
-									{
-										if (fst->FunInstVal[target_index] != G_ROM_S)
-										{
-											fst->FunInstVal[target_index] = G_ROM_S;
-											//errs()<<"4\n";
-											change++;
-										}
-									}
-									else if (fst->FunInstVal[target_index] == State)
-									{
-										errs() << " change type store\n";
-										fst->FunInstVal[target_index] = G_ROM_S;
-										change++;
-									}
-									else if (fst->FunInstVal[target_index] == No_state)
-									{
-										errs() << " change type store\n";
-										fst->FunInstVal[target_index] = G_ROM_N;
-										change++;
-									}
-
-									if (fst->FunInstVal[target_index] == G_ROM_S && Find_Val(Inst->getOperand(0), fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] == G_ROM_N)
-									{
-										fst->FunInstVal[Find_Val(Inst->getOperand(0), fst)] = G_ROM_S;
-									}
-								}
-							}
-							else if (Inst->getOpcode() != llvm::Instruction::Call)
-							{
-								if (Find_Val(Inst, fst) != VAL_Not_Found)
-								{
-									if (fst->FunInstVal[Find_Val(Inst, fst)] == No_state)
-									{
-										if (fst->FunInstVal[Find_Val(Inst, fst)] != fst->FunInstVal[i])
-										{
-											fst->FunInstVal[Find_Val(Inst, fst)] = fst->FunInstVal[i];
-											//errs()<<"5\n";
-											change++;
-										}
-									}
-									else if (fst->FunInstVal[Find_Val(Inst, fst)] == G_ROM_N)
-									{
-										if (fst->FunInstVal[i] == G_ROM_S || fst->FunInstVal[i] == State)
-										{
-											fst->FunInstVal[Find_Val(Inst, fst)] = G_ROM_S;
-											//errs()<<"6\n";
-											change++;
-										}
-									}
-								}
-							}
-						}
-					}
+					type = Join_Type(ss.ArgType[seed + 1][jj], mainst.FunInstVal[jj]);
+					grown |= type != ss.ArgType[seed + 1][jj];
+					ss.ArgType[seed + 1][jj] = type;
+					lab = labels ? sets->Union(ss.ArgLabels[seed + 1][jj], mainst.Labels[jj]) : LABEL_SET_EMPTY;
+					grown |= lab != ss.ArgLabels[seed + 1][jj];
+					ss.ArgLabels[seed + 1][jj] = lab;
 				}
+			}
+			return grown;
+		}
+
+		// 分析一个SCC直到其中函数的摘要和写入的全局变量都不再变化；无环的SCC只需一遍
+		void Scc_Solve(const std::vector<Function *> &fs, bool cyclic, TaintWords &glo, std::vector<LabelSet> &glo_lab)
+		{
+			bool grown;
+			do
+			{
+				TaintWords before(glo);
+				std::vector<LabelSet> before_lab(glo_lab);
+				grown = false;
+				for (Function *f : fs)
+					if (!f->isDeclaration())
+						grown |= Scc_Summarise(f, scc->Summary.find(f)->second, glo, glo_lab);
+				grown |= glo != before || glo_lab != before_lab;
+			} while (cyclic && grown);
+		}
+	};
+
+	struct stain : public FunctionPass, public TaintEngine
+	{
+		static char ID;
+		Module *scc_module;					//已计算过自底向上摘要的模块
+		SccState scc_state;					//自底向上模式的摘要与全局变量污点
+		unsigned scc_num, scc_levels, scc_rounds, scc_threads;
+		Module *const_module;				//const_roots所属的模块
+		DenseMap<ConstantExpr *, int> const_roots;
+		LabelSets label_sets;				//来源标签集合的共享表，各工作线程共用
+		TaintBudget module_budget;			//模块级预算，各工作线程共用
+		Module *icall_module;				//resolver所属的模块
+		CallResolver resolver;				//间接调用点的候选被调函数，各工作线程共用
+		Module *shim_module;				//shim_table所属的模块
+		ShimTable shim_table;				//模块中的shim API调用点
+		stain() : FunctionPass(ID), scc_module(NULL), const_module(NULL), icall_module(NULL), shim_module(NULL) { sets = &label_sets; }
+
+		bool doInitialization(Module &M) override
+		{
+			if (StainBench)
+				Bench_Find_Val(M.getContext());
+			return false;
+		}
 
-				if (fst->FunInst[i]->getType()->isPointerTy())
+		// 自底向上模式：按调用图SCC的逆拓扑序计算M中所有函数的摘要
+		// SCC按层分组（层号 = 1 + 其被调SCC的最大层号），同层SCC互不调用，由线程池并行分析；
+		// 同层各SCC读取本层开始时的全局变量污点，各自的写入在层结束后合并，因此结果与线程数无关。
+		// 全局变量污点在一遍中仍有变化时（调用者写入、被调函数读取），从最底层重新开始。
+		void Scc_Run(Module &M)
+		{
+			CallGraph CG(M);
+			// 间接调用点连到各候选被调函数，使其先于调用者得到摘要
+			if (icall)
+				for (auto &site : icall->Sites)
+					for (Function *callee : site.second)
+						CG[site.first->getFunction()]->addCalledFunction(cast<CallBase>(site.first), CG.getOrInsertFunction(callee));
+			std::vector<std::vector<Function *>> sccs;
+			std::vector<bool> cyclic;
+			std::vector<std::vector<int>> levels;
+			DenseMap<Function *, int> level_of;
+			for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I)
+			{
+				std::vector<Function *> fs;
+				for (CallGraphNode *N : *I)
+					if (Function *f = N->getFunction())
+						fs.push_back(f);
+				if (fs.empty())
+					continue;
+				int lv = 0;
+				for (Function *f : fs)
+					for (auto &rec : *CG[f])
+						if (Function *callee = rec.second->getFunction())
+						{
+							auto it = level_of.find(callee);
+							if (it != level_of.end())
+								lv = std::max(lv, it->second + 1);
+						}
+				for (Function *f : fs)
 				{
-					if (fst->FunInstVal[i] == State)
-					{
-						fst->FunInstVal[i] = G_ROM_S;
-						change++;
-					}
-					if (fst->FunInstVal[i] == No_state)
-					{
-						fst->FunInstVal[i] = G_ROM_N;
-						change++;
-					}
+					level_of[f] = lv;
+					scc_state.Summary[f];
 				}
+				if (lv >= (int)levels.size())
+					levels.resize(lv + 1);
+				levels[lv].push_back(sccs.size());
+				sccs.push_back(fs);
+				cyclic.push_back(I.hasCycle());
+			}
+
+			// 全局变量的初始污点类型与普通模式一致
+			if (gt.M != &M)
+				Init_Global_Table(&M);
+			scc_state.GloType = gt.Init;
+			scc_state.GloLabels.assign(gt.Vars.size(), LABEL_SET_EMPTY);
+			// MemorySSA不能在工作线程中建立，先在这里求出各函数的结果，工作线程只查表
+			scc_state.MemFlows.clear();
+			if (StainMSSA)
+				for (auto &fs : sccs)
+					for (Function *f : fs)
+						if (!f->isDeclaration())
+							Mem_Flow(f, scc_state.MemFlows[f]);
+
+			scc_threads = StainThreads ? StainThreads : hardware_concurrency().compute_thread_count();
+			ThreadPool pool(hardware_concurrency(scc_threads));
+			std::vector<std::unique_ptr<TaintEngine>> workers;
+			for (unsigned t = 0; t < scc_threads; t++)
+			{
+				workers.emplace_back(new TaintEngine());
+				workers.back()->scc = &scc_state;
+				workers.back()->ce_root = ce_root;
+				workers.back()->sets = sets;
+				workers.back()->gt = gt;
+				workers.back()->budget = budget;
+				workers.back()->icall = icall;
+				workers.back()->shim = shim;
+			}
 
-				//errs()<<"Inst";
-				if (dyn_cast<Instruction>(fst->FunInst[i]))
+			bool changed;
+			scc_rounds = 0;
+			sets->Shared = scc_threads > 1;
+			do
+			{
+				changed = false;
+				scc_rounds++;
+				for (auto &level : levels)
 				{
-					FInst = dyn_cast<Instruction>(fst->FunInst[i]);
-					if (FInst->getOpcode() == llvm::Instruction::Ret)
-					{
-						if (FInst->getNumOperands() && fst->RetType != G_ROM_S && fst->RetType != State)
-						{
-							fst->RetType = Find_Val_Type(FInst->getOperand(0), fst);
-						}
-					}
-					else if (FInst->getOpcode() != llvm::Instruction::Call && FInst->getOpcode() != llvm::Instruction::Store && FInst->getOpcode() != llvm::Instruction::Load && FInst->getOpcode() != llvm::Instruction::Alloca)
+					std::vector<TaintWords> glo(level.size(), scc_state.GloType);
+					std::vector<std::vector<LabelSet>> glo_lab(level.size(), scc_state.GloLabels);
+					std::atomic<size_t> next(0);
+					for (unsigned t = 0; t < scc_threads; t++)
 					{
-						if (Find_Val(FInst, fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(FInst, fst)] == G_ROM_S)
-						{
-							for (int ii = 0; ii < FInst->getNumOperands(); ii++)
-							{
-								if (Find_Val(FInst->getOperand(ii), fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(FInst->getOperand(ii), fst)] == G_ROM_N)
-								{
-									//errs()<<"7\n";
-									fst->FunInstVal[Find_Val(FInst->getOperand(ii), fst)] = G_ROM_S;
-									change++;
-								}
-							}
-						}
+						TaintEngine *w = workers[t].get();
+						pool.async([&, w] {
+							for (size_t k; (k = next++) < level.size();)
+								w->Scc_Solve(sccs[level[k]], cyclic[level[k]], glo[k], glo_lab[k]);
+						});
 					}
-					else if (FInst->getOpcode() == llvm::Instruction::Load)
-					{
-						for (int ii = 0; ii < FInst->getNumOperands(); ii++)
+					pool.wait();
+					for (auto &g : glo)
+						changed |= Taint_Join(scc_state.GloType, g);
+					for (auto &l : glo_lab)
+						for (size_t g = 0; g < l.size(); g++)
 						{
-							if (Find_Val(FInst->getOperand(ii), fst) != VAL_Not_Found)
-							{
-								if (fst->FunInstVal[Find_Val(FInst->getOperand(ii), fst)] == G_ROM_N)
-								{
-									if (Find_Val(FInst, fst) != VAL_Not_Found)
-									{
-										if (fst->FunInstVal[Find_Val(FInst, fst)] == G_ROM_S || fst->FunInstVal[Find_Val(FInst, fst)] == State)
-										{
-											fst->FunInstVal[Find_Val(FInst->getOperand(ii), fst)] = G_ROM_S;
-											change++;
-										}
-									}
-								}
-							}
-							else
-							{
-								if (dyn_cast<ConstantExpr>(FInst->getOperand(ii)))
-								{
-									CE = dyn_cast<ConstantExpr>(FInst->getOperand(ii));
-									SI = CE->getAsInstruction();
-									{
-										///*
-										for (int jj = 0; jj < SI->getNumOperands(); jj++)
-										{
-											if (Find_Val(SI->getOperand(jj), fst) != VAL_Not_Found)
-											{
-												if (fst->FunInstVal[Find_Val(SI->getOperand(jj), fst)] == G_ROM_S)
-												{
-													if (Find_Val(FInst, fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(FInst, fst)] == No_state)
-													{
-														fst->FunInstVal[Find_Val(FInst, fst)] = State;
-														change++;
-													}
-													else if (Find_Val(FInst, fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(FInst, fst)] == G_ROM_N)
-													{
-														fst->FunInstVal[Find_Val(FInst, fst)] = G_ROM_S;
-														change++;
-													}
-												}
-												else
-												{
-													if (Find_Val(FInst, fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(FInst, fst)] == State)
-													{
-														fst->FunInstVal[Find_Val(SI->getOperand(jj), fst)] = G_ROM_S;
-														change++;
-													}
-													else if (Find_Val(FInst, fst) != VAL_Not_Found && fst->FunInstVal[Find_Val(FInst, fst)] == G_ROM_S)
-													{
-														fst->FunInstVal[Find_Val(SI->getOperand(jj), fst)] = G_ROM_S;
-														change++;
-													}
-												}
-											}
-										}
-									}
-									SI->deleteValue();
-								}
-							}
+							LabelSet u = sets->Union(scc_state.GloLabels[g], l[g]);
+							changed |= u != scc_state.GloLabels[g];
+							scc_state.GloLabels[g] = u;
 						}
-					}
+				}
+			} while (changed);
+			sets->Shared = false;
+
+			for (auto &w : workers)
+			{
+				val_evals += w->val_evals;
+				call_evals += w->call_evals;
+				lowered_funcs += w->lowered_funcs;
+				lowered_ops += w->lowered_ops;
+				lower_ns += w->lower_ns;
+				mssa_allocas += w->mssa_allocas;
+				mssa_loads += w->mssa_loads;
+				mssa_edges += w->mssa_edges;
+				ctrl_branches += w->ctrl_branches;
+				ctrl_edges += w->ctrl_edges;
+				slice_pruned.insert(w->slice_pruned.begin(), w->slice_pruned.end());
+				frame_layouts += w->frame_layouts;
+				frames_entered += w->frames_entered;
+				frame_pages += w->frame_pages;
+				cow_pages += w->cow_pages;
+				for (auto &hit : w->budget_hits)
+				{
+					BudgetHit &h = budget_hits[hit.first];
+					h.Count += hit.second.Count;
+					h.Reasons |= hit.second.Reasons;
 				}
 			}
-			return change;
+			scc_num = sccs.size();
+			scc_levels = levels.size();
+			scc_module = &M;
 		}
 
-		int Update_Function(Function *F, funvalst *fst)
+		// 反向查询模式：对入口函数的每个汇点单独查询，输出被污染的汇点
+		void Run_Queries(Function &F)
 		{
-			if (print_flg)
-				errs() << "Function " << F->getName() << '\n';
-			BasicBlock *BB_c;
-			int change = 0;
-			unsigned char ret_type;
-			int j;
-			for (Function::iterator i = F->begin(), e = F->end(); i != e; ++i)
+			auto start = std::chrono::steady_clock::now();
+			TaintQuery q(&F, &shim_table);
+			unsigned sinks = 0, tainted = 0, tainted_br = 0;
+			for (Instruction &I : instructions(F))
 			{
-				BB_c = &*i;
-				Instruction *Inst;
-				for (BasicBlock::iterator i2 = BB_c->begin(), e2 = BB_c->end(); i2 != e2; ++i2) //
+				SmallVector<Value *, 4> vals;
+				if (BranchInst *BI = dyn_cast<BranchInst>(&I))
 				{
-					char block_split = 0;
-					Inst = &*i2;
-					if (Inst->getOpcode() == llvm::Instruction::Call)
-					{
-						if (dyn_cast<Function>(Inst->getOperand(Inst->getNumOperands() - 1)))
-						{
-							Function *subf = dyn_cast<Function>(Inst->getOperand(Inst->getNumOperands() - 1));
-							Clean_st(&subfst[subdeep]);
-							//							errs()<<"$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$\n";
-							//							errs()<<"<< deep >>"<<subdeep<<"\n";
-							Find_All_FunctionArg(subf, &subfst[subdeep]);
-							//							/*
-							for (int jj = 0; jj < subfst[subdeep].functionval_num; jj++)
-							{
-								if (Find_Val(Inst->getOperand(jj), fst) != VAL_Not_Found)
-								{
-									subfst[subdeep].FunInstVal[jj] = Find_Val_Type(Inst->getOperand(jj), fst);
-								}
-								else
-								{
-									subfst[subdeep].FunInstVal[jj] = No_state;
-								}
-							}
-							//							*/
-							Find_All_GloabalVariable(subf->getParent(), &subfst[subdeep]);
-							//							/*
-							for (int jj = 0; jj < subfst[subdeep].functionval_num; jj++)
-							{
-								if (Find_Val(subfst[subdeep].FunInst[jj], fst) != VAL_Not_Found)
-								{
-									subfst[subdeep].FunInstVal[jj] = Find_Val_Type(subfst[subdeep].FunInst[jj], fst);
-								}
-							}
-							//							*/
-							Find_All_FunctionVal(subf, &subfst[subdeep]);
-
-							subdeep++;
-							if (subdeep < MAX_SUB_FUN_DEEP)
-							{
-								if (Find_Val(Inst, fst) != VAL_Not_Found)
-									ret_type = Find_Val_Type(Inst, fst);
-								while ((Update_Val(subf, &subfst[subdeep - 1]) + Update_Function(subf, &subfst[subdeep - 1])) != 0)
-								{
-									//									Update_Val(subf,&subfst[subdeep-1]);
-								}
-								if (print_flg)
-								{
-									errs() << "$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$\n";
-									Print_Function(subf, &subfst[subdeep - 1]);
-									errs() << "$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$\n";
-								}
-								if (Find_Val(Inst, fst) != VAL_Not_Found) //return change
-								{
-									//									fst->FunInstVal[Find_Val(Inst,fst)] = State;
-									if (ret_type == No_state && subfst[subdeep - 1].RetType != No_state)
-									{
-										fst->FunInstVal[Find_Val(Inst, fst)] = subfst[subdeep - 1].RetType;
-										change++;
-									}
-								}
-								for (int ii = 0; ii < fst->functionval_num; ii++) //global val change
-								{
-									for (int jj = 0; jj < subfst[subdeep - 1].functionval_num; jj++)
-									{
-										if (fst->FunInst[ii] == subfst[subdeep - 1].FunInst[jj])
-										{
-											if (fst->FunInstVal[ii] != subfst[subdeep - 1].FunInstVal[jj])
-											{
-												fst->FunInstVal[ii] = subfst[subdeep - 1].FunInstVal[jj];
-												change++;
-											}
-										}
-									}
-								}
-								///*
-								for (int jj = 0; jj < subfst[subdeep - 1].functionarg_num; jj++) //arg change
-								{
-									if (Find_Val(Inst->getOperand(jj), fst) != VAL_Not_Found)
-									{
-										if (subfst[subdeep - 1].FunInstVal[jj] == G_ROM_S && Find_Val_Type(Inst->getOperand(jj), fst) == G_ROM_N)
-										{
-											fst->FunInstVal[Find_Val(Inst->getOperand(jj), fst)] = G_ROM_S;
-											change++;
-										}
-									}
-								}
-								//*/
-							}
-							subdeep--;
-						}
-					}
+					if (BI->isConditional())
+						vals.push_back(BI->getCondition());
+				}
+				else if (SwitchInst *SI = dyn_cast<SwitchInst>(&I))
+					vals.push_back(SI->getCondition());
+				else if (CallBase *CB = dyn_cast<CallBase>(&I))
+				{
+					if (shim_table.Sink(CB))
+						vals.append(CB->arg_begin(), CB->arg_end());
+				}
+				if (vals.empty())
+					continue;
+				sinks++;
+				bool hit = false;
+				for (Value *v : vals)
+					hit |= q.Query(v) == QUERY_TAINTED;
+				if (hit)
+				{
+					tainted++;
+					tainted_br += isa<BranchInst>(&I);
+					errs() << "tainted sink <" << tainted - 1 << ">: " << I << "\n";
 				}
 			}
-			return change;
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			// 其中被污染的br与前向分析的br attack计数对应
+			errs() << "backward queries: " << sinks << " sinks, " << tainted << " tainted (" << tainted_br << " br), " << q.Visited << " values expanded, "
+				   << q.Memo.size() << " memoized, " << format("%.2f", ms) << " ms\n";
 		}
 
 		bool runOnFunction(Function &F) override
 		{
 			subdeep = 0;
-			if (F.getName().contains("pay")) //Invoke作为入口函数进行分析
+			val_evals = call_evals = 0;
+			summary_hits = summary_misses = 0;
+			summaries.clear();
+			relevant_glo.clear();
+			programs.clear();
+			layouts.clear();
+			frame_layouts = frames_entered = frame_pages = cow_pages = 0;
+			lowered_funcs = lowered_ops = lower_ns = 0;
+			mssa_allocas = mssa_loads = mssa_edges = 0;
+			ctrl_branches = ctrl_edges = 0;
+			slice_pruned.clear();
+			budget_hits.clear();
+			label_sets.UnionHits = label_sets.UnionMisses = 0;
+			if (F.getName().contains(StainEntry)) //Invoke作为入口函数进行分析
 			{
 				errs() << "###################Function str###################\n";
 				errs() << "Function " << F.getName() << '\n';
-				Clean_st(&mainst);
+				// 前向传播与-stain-query共用同一组污点源，与是否带标签无关
+				if (shim_module != F.getParent())
+				{
+					shim_table.Build(*F.getParent());
+					shim_module = F.getParent();
+				}
+				shim = &shim_table;
+				// 反向查询只访问汇点的反向切片，不需要入口帧
+				if (StainQuery)
+				{
+					Run_Queries(F);
+					return false;
+				}
+				Clean_st(&mainst, &F, NULL);
+				if (const_module != F.getParent())
+				{
+					Build_Const_Root(*F.getParent(), const_roots);
+					const_module = F.getParent();
+				}
+				ce_root = &const_roots;
+				icall = NULL;
+				if (StainICall)
+				{
+					if (icall_module != F.getParent())
+					{
+						resolver.Build(*F.getParent());
+						icall_module = F.getParent();
+					}
+					icall = &resolver;
+				}
+				budget = NULL;
+				if (StainBudgetEvals || StainBudgetMs || StainBudgetKB || StainModuleBudgetEvals || StainModuleBudgetMs)
+				{
+					// 模块级预算从模块中第一个入口函数开始计算
+					if (module_budget.M != F.getParent())
+					{
+						module_budget.M = F.getParent();
+						module_budget.Start = std::chrono::steady_clock::now();
+						module_budget.Evals = 0;
+						module_budget.Exhausted = false;
+					}
+					budget = &module_budget;
+				}
+				if (StainSCC)
+				{
+					if (scc_module != F.getParent())
+						Scc_Run(*F.getParent());
+					scc = &scc_state;
+				}
 				print_flg=1;
 				Stain_Set(&F, &mainst);
 				Find_All_GloabalVariable(F.getParent(), &mainst);
+				if (scc)
+				{
+					std::copy(scc_state.GloType.begin(), scc_state.GloType.end(), gt.Type.begin());
+					std::copy(scc_state.GloLabels.begin(), scc_state.GloLabels.end(), gt.Labels.begin());
+				}
 				errs() << "Find_All_FunctionVal";
 				Find_All_FunctionVal(&F, &mainst);
 				Print_Function(&F,&mainst);
-				while((Update_Val(&F, &mainst) + Update_Function(&F, &mainst)) != 0);
+				auto start = std::chrono::steady_clock::now();
+				unsigned long lower_before = lower_ns;
+				Propagate(&F, &mainst);
+				unsigned long propagate_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() - (lower_ns - lower_before);
 				errs()<<"###################Function end###################\n";
 				Print_Function(&F, &mainst);
+				errs() << "transfer evaluations: " << val_evals + call_evals << " (val " << val_evals
+					   << ", call " << call_evals << ") for " << mainst.functionval_num << " slots, frame arena "
+					   << arena.Reserved() / 1024 << " KB\n";
+				errs() << "call frames: " << frames_entered << " entered over " << frame_layouts << " layouts, "
+					   << cow_pages << " of " << frame_pages << " pages copied on write\n";
+				if (scc)
+					errs() << "scc summaries: " << scc_num << " SCCs in " << scc_levels << " levels, " << scc_rounds
+						   << " global rounds, " << scc_threads << " threads\n";
+				else
+					errs() << "callee summaries: " << summary_hits << " hits, " << summary_misses << " misses\n";
+				errs() << "taint bytecode: " << lowered_funcs << " functions lowered to " << lowered_ops << " ops in "
+					   << format("%.2f", lower_ns / 1e6) << " ms, propagation " << format("%.2f", propagate_ns / 1e6) << " ms\n";
+				if (StainMSSA)
+					errs() << "memory ssa: " << mssa_loads << " loads from " << mssa_allocas << " allocas resolved to "
+						   << mssa_edges << " store edges\n";
+				if (StainImplicit)
+					errs() << "control dependence: " << ctrl_branches << " branches control " << ctrl_edges << " slots\n";
+				if (icall)
+				{
+					errs() << "indirect calls: " << icall->Targets << " targets over";
+					for (int k = 0; k < ICALL_KINDS; k++)
+						errs() << (k ? ", " : " ") << icall->Kinds[k] << " " << ICall_Names[k];
+					errs() << " sites (at most " << icall->MaxTargets << " per site), " << icall->Itabs.size() << " itabs decoded\n";
+				}
+				if (StainSlice)
+					Print_Slice(*F.getParent());
+				if (budget)
+					Print_Budget(*F.getParent());
+				if (labels)
+					Print_Labels(&F, &mainst);
 			}
 			return false;
 		}
@@ -0,0 +1,301 @@
+// copyrigth: ziming
+// introduction: stain与checker共用的污点源、汇点表，以及链码中shim API调用点的解码
+
+#ifndef FPLCHECKER_SHIM_H
+#define FPLCHECKER_SHIM_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/ArrayRef.h"
+
+#include <vector>
+
+// 污点来源标签：槽位除污点类型外还带一组来源标签，一遍传播同时覆盖各类漏洞，各检测项在汇点只看自己的标签
+typedef unsigned short TaintLabels;
+#define LABEL_INPUT (1 << 0)		// 入口函数的参数
+#define LABEL_RAND_TIME (1 << 1)	// 随机数与时间戳
+#define LABEL_MAP_ITER (1 << 2)		// map遍历顺序
+#define LABEL_EXTERNAL (1 << 3)		// web服务、系统命令、外部文件访问
+#define LABEL_PRIVATE (1 << 4)		// 隐私数据
+#define LABEL_KINDS (5)
+
+#define LABEL_OUT_RET (0)	// 返回值（含sret参数）带标签
+#define LABEL_OUT_LAST (1)	// 另外最后一个实参指向的内存带标签（如map迭代器）
+
+// 标签来源：被调函数名以Pattern开头（Infix为真时为包含Pattern）
+struct LabelSource
+{
+	const char *Pattern;
+	bool Infix;
+	TaintLabels Label;
+	unsigned char Out;
+};
+
+static const LabelSource Label_Sources[] = {
+	{"math_1rand.", false, LABEL_RAND_TIME, LABEL_OUT_RET},
+	{"crypto_1rand.", false, LABEL_RAND_TIME, LABEL_OUT_RET},
+	{"time.Now", false, LABEL_RAND_TIME, LABEL_OUT_RET},
+	{"time.Since", false, LABEL_RAND_TIME, LABEL_OUT_RET},
+	{"time.Until", false, LABEL_RAND_TIME, LABEL_OUT_RET},
+	{"runtime.mapiterinit", false, LABEL_MAP_ITER, LABEL_OUT_LAST},
+	{"runtime.mapiternext", false, LABEL_MAP_ITER, LABEL_OUT_LAST},
+	{"os.", false, LABEL_EXTERNAL, LABEL_OUT_RET},
+	{"os_1exec.", false, LABEL_EXTERNAL, LABEL_OUT_RET},
+	{"io_1ioutil.", false, LABEL_EXTERNAL, LABEL_OUT_RET},
+	{"net.", false, LABEL_EXTERNAL, LABEL_OUT_RET},
+	{"net_1http.", false, LABEL_EXTERNAL, LABEL_OUT_RET},
+	{"GetPrivateData", true, LABEL_PRIVATE, LABEL_OUT_RET},
+	{"GetTransient", true, LABEL_PRIVATE, LABEL_OUT_RET},
+};
+
+// 按被调函数名查找标签来源，包初始化函数（..import）不算
+static inline const LabelSource *Find_Label_Source(llvm::Function *F)
+{
+	llvm::StringRef name = F->getName();
+	if (name.contains("..import"))
+		return nullptr;
+	for (const LabelSource &src : Label_Sources)
+		if (src.Infix ? name.contains(src.Pattern) : name.startswith(src.Pattern))
+			return &src;
+	return nullptr;
+}
+
+// 汇点：入口函数中的条件分支，以及以下函数（按名字包含）的实参
+static const char *Sink_Calls[] = {"shim.Success", "shim.Error"};
+
+// ChaincodeStubInterface的方法，枚举值即方法在itab中的下标：
+// gollvm的itab第0项为类型描述符，其后各方法按名字排序
+enum ShimApi
+{
+	SHIM_NONE,
+	SHIM_CREATE_COMPOSITE_KEY,
+	SHIM_DEL_PRIVATE_DATA,
+	SHIM_DEL_STATE,
+	SHIM_GET_ARGS,
+	SHIM_GET_ARGS_SLICE,
+	SHIM_GET_BINDING,
+	SHIM_GET_CHANNEL_ID,
+	SHIM_GET_CREATOR,
+	SHIM_GET_DECORATIONS,
+	SHIM_GET_FUNCTION_AND_PARAMETERS,
+	SHIM_GET_HISTORY_FOR_KEY,
+	SHIM_GET_PRIVATE_DATA,	// 12
+	SHIM_GET_PRIVATE_DATA_BY_PARTIAL_COMPOSITE_KEY,
+	SHIM_GET_PRIVATE_DATA_BY_RANGE,
+	SHIM_GET_PRIVATE_DATA_HASH,
+	SHIM_GET_PRIVATE_DATA_QUERY_RESULT,
+	SHIM_GET_PRIVATE_DATA_VALIDATION_PARAMETER,
+	SHIM_GET_QUERY_RESULT,
+	SHIM_GET_QUERY_RESULT_WITH_PAGINATION,
+	SHIM_GET_SIGNED_PROPOSAL,
+	SHIM_GET_STATE,
+	SHIM_GET_STATE_BY_PARTIAL_COMPOSITE_KEY,
+	SHIM_GET_STATE_BY_PARTIAL_COMPOSITE_KEY_WITH_PAGINATION,
+	SHIM_GET_STATE_BY_RANGE,
+	SHIM_GET_STATE_BY_RANGE_WITH_PAGINATION,
+	SHIM_GET_STATE_VALIDATION_PARAMETER,
+	SHIM_GET_STRING_ARGS,
+	SHIM_GET_TRANSIENT,	// 28
+	SHIM_GET_TX_ID,
+	SHIM_GET_TX_TIMESTAMP,
+	SHIM_INVOKE_CHAINCODE,	// 31
+	SHIM_PURGE_PRIVATE_DATA,
+	SHIM_PUT_PRIVATE_DATA,	// 33
+	SHIM_PUT_STATE,
+	SHIM_SET_EVENT,
+	SHIM_SET_PRIVATE_DATA_VALIDATION_PARAMETER,
+	SHIM_SET_STATE_VALIDATION_PARAMETER,
+	SHIM_SPLIT_COMPOSITE_KEY,
+	SHIM_API_NUM
+};
+
+// shim API调用点：从ChaincodeStubInterface的itab中取出方法的getelementptr，及调用该方法的间接调用（找不到时为空）
+struct ShimCall
+{
+	llvm::Instruction *Gep;
+	llvm::CallBase *Call;
+	ShimApi Api;
+};
+
+// 取数API的结果（sret参数或返回值）带的来源标签，不是污点源时为0
+static inline TaintLabels Shim_Source(ShimApi api)
+{
+	switch (api)
+	{
+	case SHIM_GET_ARGS:
+	case SHIM_GET_ARGS_SLICE:
+	case SHIM_GET_FUNCTION_AND_PARAMETERS:
+	case SHIM_GET_STRING_ARGS:
+		return LABEL_INPUT;
+	case SHIM_GET_PRIVATE_DATA:
+	case SHIM_GET_PRIVATE_DATA_BY_PARTIAL_COMPOSITE_KEY:
+	case SHIM_GET_PRIVATE_DATA_BY_RANGE:
+	case SHIM_GET_PRIVATE_DATA_QUERY_RESULT:
+	case SHIM_GET_TRANSIENT:
+		return LABEL_PRIVATE;
+	default:
+		return 0;
+	}
+}
+
+// 写账本或调用其他链码的API，实参被污染即为汇点
+static inline bool Shim_Sink(ShimApi api)
+{
+	return api == SHIM_PUT_STATE || api == SHIM_PUT_PRIVATE_DATA || api == SHIM_INVOKE_CHAINCODE;
+}
+
+// 模块中所有shim API调用点，按模块解码一次，之后各FPL规则只读查表
+// itab指针的两种形式：未优化的IR从%ChaincodeStubInterface的第0个字段load得到；
+// 优化后接口值拆成两个i8*（如%stub.chunk0），由llvm.dbg.value记录为ChaincodeStubInterface变量的第一个字。
+// 方法由getelementptr相对itab的常量字节偏移按指针大小换算为下标，两种形式相同
+struct ShimTable
+{
+	llvm::DenseMap<llvm::Function *, std::vector<ShimCall>> Calls;
+	llvm::SmallPtrSet<llvm::Type *, 4> StubTypes;		// %ChaincodeStubInterface*结构体类型
+	llvm::SmallPtrSet<llvm::Value *, 16> ChunkItabs;	// 调试信息标出的itab字
+	llvm::DenseMap<llvm::Instruction *, ShimApi> Sites;	// 间接调用 → 所调的API
+
+	llvm::ArrayRef<ShimCall> Find(llvm::Function *F) const
+	{
+		auto it = Calls.find(F);
+		if (it == Calls.end())
+			return llvm::ArrayRef<ShimCall>();
+		return it->second;
+	}
+
+	ShimApi Api(llvm::Instruction *I) const
+	{
+		auto it = Sites.find(I);
+		return it == Sites.end() ? SHIM_NONE : it->second;
+	}
+
+	// 调用点CB的污点源标签，不是污点源时为0，out为带标签的输出：callee非空时按名字匹配Label_Sources，
+	// 否则按所调的shim取数API。stain的前向分析、-stain-query与checker都按这里判定污点源
+	TaintLabels Source(llvm::CallBase *CB, llvm::Function *callee, unsigned char &out) const
+	{
+		out = LABEL_OUT_RET;
+		if (!callee)
+			return Shim_Source(Api(CB));
+		const LabelSource *src = Find_Label_Source(callee);
+		if (!src)
+			return 0;
+		out = src->Out;
+		return src->Label;
+	}
+
+	// 调用点CB是否为汇点：名字包含Sink_Calls之一的函数，或shim写账本API
+	bool Sink(llvm::CallBase *CB) const
+	{
+		if (llvm::Function *callee = CB->getCalledFunction())
+		{
+			for (const char *name : Sink_Calls)
+				if (callee->getName().contains(name))
+					return true;
+			return false;
+		}
+		return Shim_Sink(Api(CB));
+	}
+
+	// v是否为ChaincodeStubInterface值的itab指针
+	bool Is_Itab(llvm::Value *v) const
+	{
+		using namespace llvm;
+		v = v->stripPointerCasts();
+		if (ChunkItabs.count(v))
+			return true;
+		LoadInst *LI = dyn_cast<LoadInst>(v);
+		if (!LI)
+			return false;
+		// 不能用stripPointerCasts：它会剥掉下标全为0的getelementptr本身
+		Value *p = LI->getPointerOperand();
+		if (BitCastOperator *BC = dyn_cast<BitCastOperator>(p))
+			p = BC->getOperand(0);
+		GEPOperator *GEP = dyn_cast<GEPOperator>(p);
+		return GEP && StubTypes.count(GEP->getSourceElementType()) && GEP->hasAllZeroIndices();
+	}
+
+	// 调用从itab中取出的方法指针的间接调用：getelementptr → load → call，中间可有bitcast
+	static llvm::CallBase *Find_Call(llvm::Instruction *Gep)
+	{
+		using namespace llvm;
+		SmallVector<Value *, 4> ptrs(1, Gep);
+		while (!ptrs.empty())
+		{
+			Value *p = ptrs.pop_back_val();
+			for (User *U : p->users())
+			{
+				if (isa<BitCastInst>(U))
+				{
+					ptrs.push_back(U);
+					continue;
+				}
+				LoadInst *LI = dyn_cast<LoadInst>(U);
+				if (!LI || LI->getPointerOperand() != p)
+					continue;
+				SmallVector<Value *, 2> fns(1, LI);
+				while (!fns.empty())
+				{
+					Value *fn = fns.pop_back_val();
+					for (User *V : fn->users())
+					{
+						if (isa<BitCastInst>(V))
+							fns.push_back(V);
+						else if (CallBase *CB = dyn_cast<CallBase>(V))
+							if (CB->getCalledOperand()->stripPointerCasts() == LI)
+								return CB;
+					}
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	void Build(llvm::Module &M)
+	{
+		using namespace llvm;
+		const DataLayout &DL = M.getDataLayout();
+		Calls.clear();
+		StubTypes.clear();
+		ChunkItabs.clear();
+		Sites.clear();
+		for (StructType *ST : M.getIdentifiedStructTypes())
+			if (ST->getName().startswith("ChaincodeStubInterface"))
+				StubTypes.insert(ST);
+		for (Function &F : M)
+			for (Instruction &I : instructions(F))
+				if (DbgValueInst *DV = dyn_cast<DbgValueInst>(&I))
+				{
+					DICompositeType *T = dyn_cast_or_null<DICompositeType>(DV->getVariable()->getType());
+					Optional<DIExpression::FragmentInfo> frag = DV->getExpression()->getFragmentInfo();
+					if (T && T->getName() == "ChaincodeStubInterface" && (!frag || frag->OffsetInBits == 0))
+						ChunkItabs.insert(DV->getValue());
+				}
+		unsigned word = DL.getPointerSize();
+		for (Function &F : M)
+			for (Instruction &I : instructions(F))
+			{
+				GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(&I);
+				if (!GEP || !Is_Itab(GEP->getPointerOperand()))
+					continue;
+				APInt off(DL.getIndexTypeSizeInBits(GEP->getType()), 0);
+				if (!GEP->accumulateConstantOffset(DL, off) || off.urem(word))
+					continue;
+				uint64_t k = off.getZExtValue() / word;
+				if (k <= SHIM_NONE || k >= SHIM_API_NUM)
+					continue;
+				CallBase *CB = Find_Call(GEP);
+				Calls[&F].push_back({GEP, CB, (ShimApi)k});
+				if (CB)
+					Sites[CB] = (ShimApi)k;
+			}
+	}
+};
+
+#endif
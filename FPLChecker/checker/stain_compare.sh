@@ -0,0 +1,67 @@
+#!/bin/bash
+# 对比两个版本stain Pass在testData上的结果
+# 用法: stain_compare.sh <旧版本> <新版本> <入口函数名> [其他opt参数...]
+#   版本为git提交，WORK表示当前工作区的origion.cpp
+#   每个模块比较各入口函数最终一帧（"###Function end###"到"br attack :"）的输出
+#   输出每个模块的same/DIFF/FAIL(返回码)，存在差异或失败时返回1
+# 环境变量: CXX 编译器，TIMEOUT 单个模块的超时秒数（默认1800），DATA 测试数据目录
+
+set -u
+if [ $# -lt 3 ]; then
+	sed -n '2,7p' "$0"
+	exit 2
+fi
+old=$1; new=$2; entry=$3; shift 3
+
+top=$(git -C "$(dirname "$0")" rev-parse --show-toplevel) || exit 2
+src=FPLChecker/checker/origion.cpp
+data=${DATA:-$top/FPLChecker/testData}
+CXX=${CXX:-$(command -v clang++ || echo c++)}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# 编译指定版本的origion.cpp（连同同目录的头文件）为$work/$2.so
+build()
+{
+	mkdir -p "$work/$2"
+	if [ "$1" = WORK ]; then
+		cp "$top/$(dirname $src)"/*.cpp "$top/$(dirname $src)"/*.h "$work/$2" 2>/dev/null
+	else
+		git -C "$top" archive "$1" "$(dirname $src)" | tar -x -C "$work/$2" --strip-components=2 || return 1
+	fi
+	$CXX -O2 $(llvm-config --cxxflags) -fno-rtti -fPIC -shared "$work/$2/$(basename $src)" -o "$work/$2.so" \
+		$(llvm-config --ldflags) -lpthread
+}
+
+# 运行stain并截取每个入口函数最终一帧，返回opt的返回码
+run()
+{
+	local tag=$1 file=$2
+	shift 2
+	timeout "${TIMEOUT:-1800}" opt -load "$work/$tag.so" -stain -stain-entry="$entry" "$@" \
+		-enable-new-pm=0 -disable-output "$file" > "$work/$tag.log" 2>&1
+	local rc=$?
+	awk '/###Function end###/ {on=1; next} on {print} on && /br attack :/ {on=0}' "$work/$tag.log" > "$work/$tag.fin"
+	return $rc
+}
+
+build "$old" a || exit 2
+build "$new" b || exit 2
+
+total=0; same=0
+for f in "$data"/*/*.ll; do
+	name=$(basename "$(dirname "$f")")/$(basename "$f")
+	total=$((total + 1))
+	run a "$f" "$@"; ra=$?
+	run b "$f" "$@"; rb=$?
+	if [ $ra -ne 0 ] || [ $rb -ne 0 ]; then
+		echo "FAIL($ra,$rb) $name"
+	elif cmp -s "$work/a.fin" "$work/b.fin"; then
+		echo "same $name"
+		same=$((same + 1))
+	else
+		echo "DIFF $name"
+	fi
+done
+echo "$same/$total same"
+[ $same -eq $total ]
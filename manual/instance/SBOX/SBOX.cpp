@@ -11,7 +11,6 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
-#include "llvm/IR/CallSite.h"
 #include "llvm/IR/CallingConv.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
@@ -23,6 +22,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/DenseMap.h"
 #include <map>
 
 using namespace llvm;
@@ -37,8 +37,18 @@ using namespace llvm;
 #define G_ROM_S          (3)//
 #define State            (4)// 
 #define VAL_Not_Found    (-1)// refer to data which relate to function input
+#define GLO_OTHER        (0)// no initializer, or not integers
+#define GLO_ROM          (1)// integer table, every element has the same width
+#define GLO_SCALAR       (2)// integer scalar
 char flg = 0;
 char print_flg;
+struct GlobalClass// scanned once per module
+{
+	unsigned char Role;// GLO_ROM / GLO_SCALAR / GLO_OTHER
+	unsigned Width;// bits: element width of a table, own width of a scalar, else width of the last element (0 if not integer)
+	unsigned Count;// aggregate elements of the initializer, 0 if not aggregate
+	bool LastData;// last element is ConstantData
+};
 struct funvalst
 {
 	void *Function_Basics[MAX_BASICBLOCK];
@@ -48,6 +58,7 @@ struct funvalst
 	int functionval_num;
 	int functionarg_num;
 	int functionglo_num;
+	DenseMap<Value *,int> ValIndex;// Value* -> index of FunInst
 };
 namespace 
 {// SBOX - The first implementation, without getAnalysisUsage.
@@ -57,8 +68,10 @@ namespace
 		funvalst mainst;
 		funvalst subfst[MAX_SUB_FUN_DEEP];
 		int subdeep;
+		Module *glo_module;
+		DenseMap<GlobalVariable *,GlobalClass> glo_class;
 
-    	SBOX() : FunctionPass(ID) 	
+    	SBOX() : FunctionPass(ID), glo_module(NULL)	
 		{
 		}
 		void Clean_st(funvalst * fst)
@@ -69,30 +82,39 @@ namespace
 			for(unsigned int i=0;i<MAX_VAL_Fun;i++)fst->FunInst[i]=NULL;
 			for(unsigned int i=0;i<MAX_VAL_Fun;i++)fst->FunInstVal[i]=No_state;		
 			fst->RetType = No_state;
+			fst->ValIndex.clear();
 		}
-		bool IS_ROM(GlobalVariable * g)
+		void Insert_Val(Value *v,funvalst * fst)
 		{
-			int l=0;
-			unsigned int witwidth;
-			Constant *CT;
-			if(CT =	g->getInitializer()->getAggregateElement(l)){l++;}
-			else return 0;
-			if(dyn_cast<ConstantInt>(CT)){witwidth = dyn_cast<ConstantInt>(CT)->getBitWidth();}
-			else return 0;	
-			l++;
-			while(CT =	g->getInitializer()->getAggregateElement(l))
+			fst->FunInst[fst->functionval_num] = v;
+			fst->ValIndex.try_emplace(v,fst->functionval_num);
+		}
+		GlobalClass Classify_Global(GlobalVariable * g)
+		{
+			GlobalClass gc = {GLO_OTHER,0,0,false};
+			bool same_width = true;
+			if(!g->hasInitializer())return gc;
+			while(Constant *CT = g->getInitializer()->getAggregateElement(gc.Count))
 			{
-				if(dyn_cast<ConstantInt>(CT))
-				{
-					if(witwidth != dyn_cast<ConstantInt>(CT)->getBitWidth())
-					{
-						return 0;
-					}
-				}
-				else return 0;	
-				l++;
+				ConstantInt *CI = dyn_cast<ConstantInt>(CT);
+				if(!CI || (gc.Count>0 && CI->getBitWidth()!=gc.Width))same_width = false;
+				gc.Width = CI ? CI->getBitWidth() : 0;
+				gc.LastData = isa<ConstantData>(CT);
+				gc.Count++;
 			}
-			return 1;
+			if(gc.Count>0 && same_width)gc.Role = GLO_ROM;
+			else if(ConstantInt *CI = dyn_cast<ConstantInt>(g->getInitializer())){gc.Role = GLO_SCALAR;gc.Width = CI->getBitWidth();}
+			return gc;
+		}
+		GlobalClass &Find_Global_Class(GlobalVariable * g)
+		{
+			if(glo_module != g->getParent())
+			{
+				glo_class.clear();
+				for(GlobalVariable &gv: g->getParent()->globals())glo_class[&gv] = Classify_Global(&gv);
+				glo_module = g->getParent();
+			}
+			return glo_class[g];
 		}
 
 		Value* Find_Used_Inst(Value * v)
@@ -157,24 +179,23 @@ namespace
 			for(Module::global_iterator i = M->global_begin(),e = M->global_end();i!=e;++i)
 			{
 				errs()<<fst->functionval_num;
-				fst->FunInst[fst->functionval_num] = &*i;
-				l=0;
+				Insert_Val(&*i, fst);
+				GlobalClass &gc = Find_Global_Class(&*i);
+				l=gc.Count;
 				if(print_flg)errs()<<i->getName()<<" ";
-				while(i->getInitializer()->getAggregateElement(l))l++;
 				if(l==0)l=1;//have only single value;
 				errs()<<"1";
-				if(IS_ROM(&*i))
+				if(gc.Role==GLO_ROM)
 				{
 					errs()<<"2";
-					Constant *CT = i->getInitializer()->getAggregateElement(l-1);
 					fst->FunInstVal[fst->functionval_num] = G_ROM_N;
-					if(print_flg && dyn_cast<ConstantInt>(CT))errs()<<" "<<dyn_cast<ConstantInt>(CT)->getBitWidth()/8<<"Byte X "<<"["<<l<<"] G_ROM\n";
+					if(print_flg)errs()<<" "<<gc.Width/8<<"Byte X "<<"["<<l<<"] G_ROM\n";
 				}
 				else 
 				{
 					errs()<<"3";
 					fst->FunInstVal[fst->functionval_num] = No_state;
-					if(print_flg && dyn_cast<ConstantInt>(i->getInitializer()))errs()<< dyn_cast<ConstantInt>(i->getInitializer())->getBitWidth()/8<<"Byte X "<<"["<<l<<"] State\n";
+					if(print_flg && gc.Role==GLO_SCALAR)errs()<< gc.Width/8<<"Byte X "<<"["<<l<<"] State\n";
 				}
 				errs()<<"4";
 				fst->functionval_num++;
@@ -192,7 +213,7 @@ namespace
 			for(Function::arg_iterator i = F->arg_begin(),e = F->arg_end();i!=e;++i)
 			{
 				arg = &*i;
-				fst->FunInst[fst->functionval_num] = arg;
+				Insert_Val(arg, fst);
 				if(i->getType()->getTypeID() != Type::PointerTyID)fst->FunInstVal[fst->functionval_num] = State;
 				else fst->FunInstVal[fst->functionval_num] = State;//which don't know the data struct
 				if(print_flg)errs()<<"arg: %"<<fst->functionval_num<<"\n";
@@ -211,7 +232,7 @@ namespace
 			for(Function::arg_iterator i = F->arg_begin(),e = F->arg_end();i!=e;++i)
 			{
 				arg = &*i;
-				fst->FunInst[fst->functionval_num] = arg;
+				Insert_Val(arg, fst);
 				//				if(i->getType()->getTypeID() != Type::PointerTyID)fst->FunInstVal[fst->functionval_num] = State;
 				//				else fst->FunInstVal[fst->functionval_num] = State;//which don't know the data struct
 				if(print_flg)errs()<<"arg: %"<<fst->functionval_num<<"\n";
@@ -229,15 +250,9 @@ namespace
 
 		int Find_Val(Value* v,funvalst * fst)
 		{
-			int i;
-			for(i=0;i<fst->functionval_num;i++)
-			{
-				if(fst->FunInst[i]==v)
-				{
-					return i;
-				}
-			}
-			return -1;
+			auto it = fst->ValIndex.find(v);
+			if(it==fst->ValIndex.end())return VAL_Not_Found;
+			return it->second;
 		}
 
 		void Serch_Blocks(BasicBlock *BB_c,funvalst * fst)
@@ -252,13 +267,13 @@ namespace
 				{
 					if(Inst->getOpcode() == Instruction::Alloca)
 					{
-						fst->FunInst[fst->functionval_num] = Inst;
+						Insert_Val(Inst, fst);
 						fst->FunInstVal[fst->functionval_num] = G_ROM_N;
 						fst->functionval_num++;
 					}
 					else
 					{
-						fst->FunInst[fst->functionval_num] = Inst;
+						Insert_Val(Inst, fst);
 						if(Inst->getType()->isPointerTy())fst->FunInstVal[fst->functionval_num] = G_ROM_N;
 						else fst->FunInstVal[fst->functionval_num] = No_state;
 						fst->functionval_num++;						
@@ -268,14 +283,14 @@ namespace
 				{
 					if(Inst->getNumOperands())
 					{
-						fst->FunInst[fst->functionval_num] = Inst;
+						Insert_Val(Inst, fst);
 						if(Inst->getOperand(0)->getType()->isPointerTy())fst->FunInstVal[fst->functionval_num] = G_ROM_N;
 						else fst->FunInstVal[fst->functionval_num] = No_state;
 						fst->functionval_num++;
 					}
 					else
 					{
-						fst->FunInst[fst->functionval_num] = Inst;
+						Insert_Val(Inst, fst);
 						fst->FunInstVal[fst->functionval_num] = No_state;
 						fst->functionval_num++;
 					}					
@@ -295,12 +310,9 @@ namespace
 
 		unsigned char Find_Val_Type(Value *u,funvalst * fst)
 		{
-			int i;
-			for(i=0;i<fst->functionval_num;i++)
-			{
-				if(fst->FunInst[i]==u)return fst->FunInstVal[i];
-			}
-			return VAL_Not_Found;
+			int i = Find_Val(u,fst);
+			if(i==VAL_Not_Found)return VAL_Not_Found;
+			return fst->FunInstVal[i];
 		}
 
 		int Update_Val(Function *F,funvalst * fst)
@@ -629,18 +641,14 @@ namespace
 								if(dyn_cast<GlobalVariable>(fst->FunInst[Find_Val(Inst->getOperand(0),fst)]))
 								{
 									GlobalVariable * g = dyn_cast<GlobalVariable>(fst->FunInst[Find_Val(Inst->getOperand(0),fst)]);
+									GlobalClass &gc = Find_Global_Class(g);
 									if(g->isConstant())
 									{
-										unsigned int l=0;
-										while(g->getInitializer()->getAggregateElement(l))l++;
+										unsigned int l=gc.Count;
 										if(l==0)l=1;//have only single value;
-										if(IS_ROM(g))
+										if(gc.Role==GLO_ROM)
 										{
-											Constant *CT = g->getInitializer()->getAggregateElement(l-1);
-											if(dyn_cast<ConstantInt>(CT))
-												errs()<<" [const ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" word size: "<<dyn_cast<ConstantInt>(CT)->getBitWidth()/8<<"*"<<l<<">";
-											else if(dyn_cast<ConstantData>(CT))
-												errs()<<" [const ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" Byte size: "<<l<<">";
+											errs()<<" [const ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" word size: "<<gc.Width/8<<"*"<<l<<">";
 										}
 										else errs()<<" [const ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" Byte size: "<<" UN "<<">";
 									
@@ -649,15 +657,13 @@ namespace
 									}
 									else
 									{
-										unsigned int l=0;
-										while(g->getInitializer()->getAggregateElement(l))l++;
+										unsigned int l=gc.Count;
 
 										if(l!=0)
 										{
-											Constant *CT = g->getInitializer()->getAggregateElement(l-1);
-											if(dyn_cast<ConstantInt>(CT))
-												errs()<<" [ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" word size: "<<dyn_cast<ConstantInt>(CT)->getBitWidth()/8<<"*"<<l<<">";
-											else if(dyn_cast<ConstantData>(CT))
+											if(gc.Width)
+												errs()<<" [ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" word size: "<<gc.Width/8<<"*"<<l<<">";
+											else if(gc.LastData)
 												errs()<<" [ROM cache atack may be!]"<<" <"<<g->getName()<<" : ["<<rom_num<<"]"<<" Byte size: "<<l<<">";
 										}
 										else